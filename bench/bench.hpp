@@ -0,0 +1,61 @@
+//
+// Termwrap
+//
+// bench/bench.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// A small benchmark harness for termwrap_bench. Each benchmark is a function that performs a batch of work and
+// returns how many operations it did; the harness grows the batch until it runs for long enough to time, repeats
+// it and reports the median time per operation.
+
+#ifndef RHC_TERMWRAP_BENCH_H
+#define RHC_TERMWRAP_BENCH_H
+
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace termwrap::bench
+{
+	// Performs batch_size repetitions of the benchmarked operation and returns the number of operations done.
+	using benchmark_function = std::function<std::size_t(std::size_t batch_size)>;
+
+	struct benchmark
+	{
+		std::string name;
+		benchmark_function run;
+	};
+
+	class registry
+	{
+		std::vector<benchmark> benchmarks{};
+
+	public:
+		void add(std::string name, benchmark_function run)
+		{
+			benchmarks.push_back(benchmark{std::move(name), std::move(run)});
+		}
+
+		const std::vector<benchmark>& all() const noexcept { return benchmarks; }
+	}; // End of class registry.
+
+	// Keeps the compiler from optimizing away a value that is computed only to be measured.
+	template <class T>
+	inline void do_not_optimize(const T& value)
+	{
+		asm volatile("" : : "r,m"(value) : "memory");
+	}
+
+	void register_utf8_benchmarks(registry& benchmarks);
+	void register_driver_benchmarks(registry& benchmarks);
+	void register_diff_benchmarks(registry& benchmarks);
+	void register_textbox_benchmarks(registry& benchmarks);
+	void register_input_benchmarks(registry& benchmarks);
+} // End of namespace termwrap::bench.
+
+#endif // !RHC_TERMWRAP_BENCH_H.
@@ -0,0 +1,154 @@
+//
+// Termwrap
+//
+// bench/diff_bench.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Compares the front/back buffer diff kernels with a plain per-cell loop on a range of grid sizes.
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "../driver/cell_buffer.hpp"
+#include "../driver/diff_kernel.hpp"
+#include "../driver/simd.hpp"
+
+using namespace termwrap;
+
+namespace
+{
+	// The path the driver took before the diff kernel: every cell compared on its own.
+	void diff_row_per_cell(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs)
+	{
+		for (ordinate_t x = min_x; x <= max_x; ++x)
+		{
+			const bool changed = back.code_point(x, y) != front.code_point(x, y) || back.style(x, y) != front.style(x, y);
+			if (!changed)
+				continue;
+			if (!runs.empty() && runs.back().end == x)
+				++runs.back().end;
+			else
+				runs.push_back(cell_run{x, static_cast<ordinate_t>(x + 1)});
+		}
+	}
+
+	struct diff_case
+	{
+		cell_buffer back;
+		cell_buffer front;
+		std::vector<cell_run> runs;
+	};
+
+	std::shared_ptr<diff_case> make_case(const ordinate_t width, const ordinate_t height, const double ratio)
+	{
+		auto c = std::make_shared<diff_case>(diff_case{cell_buffer(width, height), cell_buffer(width, height), {}});
+		c->runs.reserve(width);
+		std::mt19937 generator(42);
+		std::bernoulli_distribution change(ratio);
+		for (ordinate_t y = 0; y < height; ++y)
+		{
+			for (ordinate_t x = 0; x < width; ++x)
+			{
+				if (change(generator))
+					c->back.set(x, y, 'a' + (x+y)%26, static_cast<style_id_t>(x%8));
+			}
+		}
+		return c;
+	}
+
+	// Checks that a kernel finds the same runs as the per-cell loop on every row, both across the whole row and
+	// within a window whose edges fall part way into a vector.
+	template <class Diff>
+	bool matches_per_cell(const diff_case& c, Diff&& diff)
+	{
+		const ordinate_t width = c.back.width();
+		const struct { ordinate_t min_x, max_x; } windows[] = { {0, static_cast<ordinate_t>(width - 1)}, {3, static_cast<ordinate_t>(width - 6)} };
+		std::vector<cell_run> expected;
+		std::vector<cell_run> found;
+		for (ordinate_t y = 0; y < c.back.height(); ++y)
+		{
+			for (const auto& window : windows)
+			{
+				expected.clear();
+				found.clear();
+				diff_row_per_cell(c.back, c.front, y, window.min_x, window.max_x, expected);
+				diff(c.back, c.front, y, window.min_x, window.max_x, found);
+				const auto same = [](const cell_run& a, const cell_run& b) { return a.begin == b.begin && a.end == b.end; };
+				if (!std::equal(expected.begin(), expected.end(), found.begin(), found.end(), same))
+					return false;
+			}
+		}
+		return true;
+	}
+
+	// Diffs every row of the grid once and returns the number of changed cells found.
+	template <class Diff>
+	std::size_t diff_frame(diff_case& c, Diff&& diff)
+	{
+		std::size_t changed_cells = 0;
+		for (ordinate_t y = 0; y < c.back.height(); ++y)
+		{
+			c.runs.clear();
+			diff(c.back, c.front, y, 0, c.back.width()-1, c.runs);
+			for (const auto& run : c.runs)
+				changed_cells += run.end - run.begin;
+		}
+		return changed_cells;
+	}
+} // End of anonymous namespace.
+
+namespace termwrap::bench
+{
+	// One operation is a diff of a whole frame. Every kernel's runs are checked against the per-cell loop's before
+	// it is registered, so a kernel that disagrees is never timed.
+	void register_diff_benchmarks(registry& benchmarks)
+	{
+		const struct { ordinate_t width, height; } grids[] = { {80, 24}, {200, 60}, {400, 120} };
+		const struct { double ratio; const char* name; } change_ratios[] = { {0.01, "1pct"}, {0.25, "25pct"} };
+		const simd_level levels[] = { simd_level::scalar, simd_level::sse2, simd_level::avx2 };
+
+		for (const auto& grid : grids)
+		{
+			for (const auto& ratio : change_ratios)
+			{
+				const auto c = make_case(grid.width, grid.height, ratio.ratio);
+				const std::string suffix = "/" + std::to_string(grid.width) + "x" + std::to_string(grid.height) + "/" + ratio.name;
+
+				benchmarks.add("diff/per_cell" + suffix, [c](const std::size_t batch)
+				{
+					for (std::size_t frame = 0; frame < batch; ++frame)
+						do_not_optimize(diff_frame(*c, diff_row_per_cell));
+					return batch;
+				});
+
+				for (const simd_level level : levels)
+				{
+					if (level > active_simd_level())
+						continue;
+					const auto diff = [level](auto&&... args) { diff_row(args..., level); };
+					if (!matches_per_cell(*c, diff))
+					{
+						std::cerr << "Kernel " << to_string(level) << " disagrees with the per-cell diff on " << suffix << ".\n";
+						std::exit(EXIT_FAILURE);
+					}
+					benchmarks.add(std::string("diff/") + to_string(level) + suffix, [c, diff](const std::size_t batch)
+					{
+						for (std::size_t frame = 0; frame < batch; ++frame)
+							do_not_optimize(diff_frame(*c, diff));
+						return batch;
+					});
+				}
+			}
+		}
+	}
+} // End of namespace termwrap::bench.
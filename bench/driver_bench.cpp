@@ -0,0 +1,224 @@
+//
+// Termwrap
+//
+// bench/driver_bench.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Full-screen paints through the driver's drawing calls, presented to a headless backend. Consecutive frames
+// alternate between two contents so that every frame has work for the diff and the encoder.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <string>
+#include <utility>
+
+#include "bench.hpp"
+#include "../driver/driver.hpp"
+#include "../driver/headless_backend.hpp"
+
+namespace termwrap::bench
+{
+	namespace
+	{
+		constexpr ordinate_t screen_width = 200;
+		constexpr ordinate_t screen_height = 60;
+
+		std::unique_ptr<driver> make_headless_driver()
+		{
+			auto terminal = std::make_unique<headless_backend>(screen_width, screen_height);
+			terminal->set_record_output(false);
+			terminal->set_emulate_screen(false);
+			auto d = std::make_unique<driver>(std::move(terminal));
+			d->set_frame_interval(std::chrono::steady_clock::duration::zero());
+			return d;
+		}
+
+		string make_row(const char first)
+		{
+			std::string row;
+			for (ordinate_t x = 0; x < screen_width; ++x)
+				row.push_back(static_cast<char>(first + x % 26));
+			return string(row);
+		}
+
+		string make_block(const char first)
+		{
+			std::string block;
+			for (ordinate_t y = 0; y < screen_height; ++y)
+			{
+				for (ordinate_t x = 0; x < screen_width; ++x)
+					block.push_back(static_cast<char>(first + (x + y) % 26));
+			}
+			return string(block);
+		}
+
+		// Paints random frames and checks after each present that the screen the headless backend emulates holds
+		// what the back buffer does, characters and styles. Scattered changes in a few styles make the encoder choose
+		// between every kind of cursor move, overwriting included, and between cached SGR changes and full resets.
+		// Returns the number of the first frame that differs, or 0 if none does.
+		std::size_t check_encoder_against_screen(const std::size_t frames)
+		{
+			auto terminal = std::make_unique<headless_backend>(80, 24);
+			terminal->set_record_output(false);
+			const headless_backend& screen = *terminal;
+			driver d(std::move(terminal));
+			d.set_frame_interval(std::chrono::steady_clock::duration::zero());
+
+			const cell_style styles[] = {
+				cell_style(),
+				cell_style(font_weight::bold),
+				cell_style(text_decoration::underline),
+				cell_style(color::red, color::blue),
+				cell_style(color::yellow, color::unset, font_weight::bold, text_decoration::underline),
+				cell_style(color_value::palette(208), color_value::palette(17)),
+				cell_style(color_value::rgb(255, 128, 0), color_value::rgb(0, 0, 40), font_weight::bold)
+			};
+			const u8char_t characters[] = { U' ', U'a', U'b', U'Z', U'.', U'\u00e9', U'\u2500' };
+			std::mt19937 generator(7);
+			const auto pick = [&generator](const std::size_t n) { return static_cast<std::size_t>(generator() % n); };
+
+			for (std::size_t frame = 1; frame <= frames; ++frame)
+			{
+				// A few short runs, mostly near one another, and now and then a whole row.
+				const std::size_t runs = 1 + pick(8);
+				for (std::size_t r = 0; r < runs; ++r)
+				{
+					const auto y = static_cast<ordinate_t>(pick(d.console_height()));
+					const auto x = static_cast<ordinate_t>(pick(d.console_width()));
+					const std::size_t length = (pick(10) == 0) ? d.console_width() : 1 + pick(6);
+					const cell_style& style = styles[pick(std::size(styles))];
+					for (std::size_t i = 0; i < length && x + i < d.console_width(); ++i)
+						d.set_cell(static_cast<ordinate_t>(x + i), y, characters[pick(std::size(characters))], style);
+				}
+				if (pick(4) == 0)
+					d.set_cursor_position(static_cast<ordinate_t>(pick(d.console_width())), static_cast<ordinate_t>(pick(d.console_height())));
+				else if (pick(4) == 0)
+					d.hide_cursor();
+				d.flush_now();
+
+				for (ordinate_t y = 0; y < d.console_height(); ++y)
+				{
+					for (ordinate_t x = 0; x < d.console_width(); ++x)
+					{
+						if (screen.screen().code_point(x, y) != d.get_cell_text(x, y) || !(screen.style_at(x, y) == d.get_cell_style(x, y)))
+							return frame;
+					}
+				}
+			}
+			return 0;
+		}
+	} // End of anonymous namespace.
+
+	// The encoder is checked against the emulated screen before anything is registered, so that a frame encoded
+	// wrongly is never timed.
+	void register_driver_benchmarks(registry& benchmarks)
+	{
+		if (const std::size_t frame = check_encoder_against_screen(2000))
+		{
+			std::cerr << "Frame " << frame << " as the headless terminal shows it differs from the back buffer.\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		benchmarks.add("driver/paint_write_at", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			static const string contents[2] = { make_row('a'), make_row('A') };
+			for (std::size_t frame = 0; frame < batch; ++frame)
+			{
+				const cell_style style((frame % 2) ? font_weight::bold : font_weight::normal);
+				for (ordinate_t y = 0; y < screen_height; ++y)
+					d->write_at(0, y, contents[frame % 2], style);
+				d->flush_now();
+			}
+			return batch;
+		});
+
+		benchmarks.add("driver/paint_write_block_at", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			static const string contents[2] = { make_block('a'), make_block('A') };
+			for (std::size_t frame = 0; frame < batch; ++frame)
+			{
+				d->write_block_at(0, 0, contents[frame % 2]);
+				d->flush_now();
+			}
+			return batch;
+		});
+
+		benchmarks.add("driver/paint_set_block_style", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			const cell_style styles[2] = { cell_style(), cell_style(color::yellow, color::blue) };
+			for (std::size_t frame = 0; frame < batch; ++frame)
+			{
+				d->set_block_style(0, 0, screen_width-1, screen_height-1, styles[frame % 2]);
+				d->flush_now();
+			}
+			return batch;
+		});
+
+		// Pane backgrounds: a rectangle of each half of the screen filled with one character and style, alternating.
+		benchmarks.add("driver/paint_fill_rect", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			const cell_style styles[2] = { cell_style(color::white, color::blue), cell_style(color::black, color::cyan) };
+			for (std::size_t frame = 0; frame < batch; ++frame)
+			{
+				d->fill_rect(0, 0, screen_width/2 - 1, screen_height-1, (frame % 2) ? U'.' : U' ', styles[frame % 2]);
+				d->fill_rect(screen_width/2, 0, screen_width-1, screen_height-1, (frame % 2) ? U' ' : U'.', styles[(frame + 1) % 2]);
+				d->flush_now();
+			}
+			return batch;
+		});
+
+		// The same fills repeated on an unchanged screen, as a redraw of a static layout does: nothing is stored,
+		// damaged or sent. One operation is one full-screen fill_rect.
+		benchmarks.add("driver/fill_rect_unchanged", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			const cell_style style(color::white, color::blue);
+			for (std::size_t i = 0; i < batch; ++i)
+				d->fill_rect(0, 0, screen_width-1, screen_height-1, U' ', style);
+			d->flush_now();
+			return batch;
+		});
+
+		// A heatmap: every cell its own RGB background, shifting each frame. At truecolor depth each colour is sent as
+		// it is; at 256 and 8 colours each is first reduced to the nearest palette entry.
+		const std::pair<const char*, color_depth> heatmap_depths[] = { {"truecolor", color_depth::truecolor}, {"palette", color_depth::palette}, {"basic", color_depth::basic} };
+		for (const auto& [name, depth] : heatmap_depths)
+		{
+			benchmarks.add(std::string("driver/paint_heatmap/") + name, [d = std::shared_ptr<driver>(make_headless_driver()), depth = depth](const std::size_t batch)
+			{
+				d->set_color_depth(depth);
+				for (std::size_t frame = 0; frame < batch; ++frame)
+				{
+					for (ordinate_t y = 0; y < screen_height; ++y)
+					{
+						for (ordinate_t x = 0; x < screen_width; ++x)
+						{
+							const auto heat = static_cast<std::uint8_t>(x + y + frame);
+							d->set_cell(x, y, ' ', cell_style(color::unset, color_value::rgb(heat, 0, 255 - heat)));
+						}
+					}
+					d->flush_now();
+				}
+				return batch;
+			});
+		}
+
+		// Drawing without presenting, to separate the cost of the back buffer writes from the diff and encoding.
+		benchmarks.add("driver/write_at_row", [d = std::shared_ptr<driver>(make_headless_driver())](const std::size_t batch)
+		{
+			static const string row = make_row('a');
+			const cell_style style{};
+			for (std::size_t i = 0; i < batch; ++i)
+				d->write_at(0, i % screen_height, row, style);
+			return batch;
+		});
+	}
+} // End of namespace termwrap::bench.
@@ -0,0 +1,190 @@
+//
+// Termwrap
+//
+// bench/input_bench.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Input handling: translating termbox's native key codes, replaying scripted key events through a headless driver as
+// macro replay does, with and without a keymap, one at a time and drained in a batch, and reading keys from a pipe
+// as from a tty, on the drawing thread and on the input thread.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <poll.h>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+#include "bench.hpp"
+#include "../driver/driver.hpp"
+#include "../driver/headless_backend.hpp"
+#include "../driver/key_translation.hpp"
+
+namespace termwrap::bench
+{
+	namespace
+	{
+		// Ctrl+A, tab, enter, escape, backspace, F1, home, the arrow keys and a mouse code, which is not a key.
+		constexpr native_key_t native_keys[] = { 0x01, 0x09, 0x0d, 0x1b, 0x7f, 0xffff, 0xffff-14, 0xffff-18, 0xffff-19, 0xffff-20, 0xffff-21, 0xffff-22 };
+
+		void push_keys(headless_backend& terminal, const std::size_t count)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				terminal.push_key_event(key_event(static_cast<u8char_t>('a' + i%26), i%7 == 0));
+		}
+
+		// One operation is one scripted key event pushed and then handed out by wait_for_event.
+		std::size_t replay(driver& d, headless_backend& terminal, const std::size_t batch)
+		{
+			push_keys(terminal, batch);
+			std::size_t handed_out = 0;
+			while (d.wait_for_event(std::chrono::milliseconds(0)))
+				++handed_out;
+			return handed_out;
+		}
+
+		struct replay_case
+		{
+			driver d;
+			headless_backend& terminal;
+		};
+
+		std::shared_ptr<replay_case> make_replay_case()
+		{
+			auto terminal = std::make_unique<headless_backend>(80, 24);
+			terminal->set_record_output(false);
+			terminal->set_emulate_screen(false);
+			headless_backend& backend = *terminal;
+			auto c = std::shared_ptr<replay_case>(new replay_case{driver(std::move(terminal)), backend});
+			c->d.set_frame_interval(std::chrono::steady_clock::duration::zero());
+			return c;
+		}
+
+		// A terminal whose input is a pipe, one octet to a key. Frames are thrown away.
+		class pipe_backend : public backend
+		{
+			int fds[2] = { -1, -1 };
+
+		public:
+			pipe_backend()
+			{
+				if (::pipe(fds) < 0)
+					throw std::runtime_error("Could not create a pipe.");
+			}
+			~pipe_backend()
+			{
+				::close(fds[0]);
+				::close(fds[1]);
+			}
+
+			int write_fd() const noexcept { return fds[1]; }
+
+			ordinate_t width() const override { return 80; }
+			ordinate_t height() const override { return 24; }
+			bool clears_on_resize() const override { return false; }
+			color_depth colors() const override { return color_depth::truecolor; }
+			void write(const char* const , const std::size_t ) override { }
+			void write_control(const char* const , const std::size_t ) override { }
+			void set_mouse_reporting(const bool ) override { }
+			int input_fd() const override { return fds[0]; }
+			void refresh_size() override { }
+
+			std::optional<event> poll_event(const unsigned wait_ms) override
+			{
+				struct pollfd input{fds[0], POLLIN, 0};
+				char octet;
+				if (::poll(&input, 1, static_cast<int>(wait_ms)) <= 0 || ::read(fds[0], &octet, 1) != 1)
+					return {};
+				return key_event(static_cast<u8char_t>(octet));
+			}
+		};
+
+		struct pipe_case
+		{
+			driver d;
+			int write_fd;
+		};
+
+		std::shared_ptr<pipe_case> make_pipe_case(const bool input_thread)
+		{
+			auto terminal = std::make_unique<pipe_backend>();
+			const int write_fd = terminal->write_fd();
+			auto c = std::shared_ptr<pipe_case>(new pipe_case{driver(std::move(terminal)), write_fd});
+			c->d.set_bracketed_paste(false);
+			c->d.set_input_thread(input_thread);
+			return c;
+		}
+
+		// One operation is one key written to the pipe and handed out by wait_for_event. Keys are written a chunk
+		// at a time, so that the pipe never fills.
+		std::size_t pipe_replay(pipe_case& c, const std::size_t batch)
+		{
+			static const std::string keys(256, 'k');
+			std::size_t written = 0;
+			std::size_t handed_out = 0;
+			while (written < batch)
+			{
+				const std::size_t chunk = std::min(keys.size(), batch - written);
+				if (::write(c.write_fd, keys.data(), chunk) != static_cast<ssize_t>(chunk))
+					throw std::runtime_error("Could not write to the pipe.");
+				written += chunk;
+				while (handed_out < written && c.d.wait_for_event(std::chrono::milliseconds(100)))
+					++handed_out;
+			}
+			return handed_out;
+		}
+	} // End of anonymous namespace.
+
+	void register_input_benchmarks(registry& benchmarks)
+	{
+		// One operation is one native key code translated, with Alt on every other key.
+		benchmarks.add("input/translate_key", [](const std::size_t batch)
+		{
+			for (std::size_t i = 0; i < batch; ++i)
+				do_not_optimize(translate_key(native_keys[i % std::size(native_keys)], 0, i & 1));
+			return batch;
+		});
+
+		benchmarks.add("input/replay", [c = make_replay_case()](const std::size_t batch)
+		{
+			return replay(c->d, c->terminal, batch);
+		});
+
+		// The same with every other letter rebound.
+		benchmarks.add("input/replay_keymap", [c = make_replay_case()](const std::size_t batch)
+		{
+			if (c->d.get_keymap().empty())
+			{
+				for (u8char_t ch = 'a'; ch < 'z'; ch += 2)
+					c->d.get_keymap().bind(key_event(ch), key_event(special_key::F1, false, true));
+			}
+			return replay(c->d, c->terminal, batch);
+		});
+
+		// The same events handed out in one batch by drain_events.
+		benchmarks.add("input/replay_drained", [c = make_replay_case(), events = std::vector<event>()](const std::size_t batch) mutable
+		{
+			push_keys(c->terminal, batch);
+			events.clear();
+			return c->d.drain_events(events);
+		});
+
+		benchmarks.add("input/pipe_replay", [c = make_pipe_case(false)](const std::size_t batch)
+		{
+			return pipe_replay(*c, batch);
+		});
+
+		// The same with the pipe read on the input thread.
+		benchmarks.add("input/pipe_replay_threaded", [c = make_pipe_case(true)](const std::size_t batch)
+		{
+			return pipe_replay(*c, batch);
+		});
+	}
+} // End of namespace termwrap::bench.
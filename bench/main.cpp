@@ -0,0 +1,206 @@
+//
+// Termwrap
+//
+// bench/main.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// termwrap_bench runs the microbenchmarks headless and prints the results as JSON (or TSV with --tsv).
+//
+//	termwrap_bench [--filter SUBSTRING] [--min-time SECONDS] [--repetitions N] [--tsv]
+//	               [--baseline FILE [--tolerance FRACTION]]
+//
+// With --baseline, the results are compared with a JSON file saved from an earlier run and the exit status is
+// non-zero if any benchmark is slower than its baseline by more than the tolerance (default 0.10).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+
+using namespace termwrap::bench;
+
+namespace
+{
+	struct options
+	{
+		std::string filter{};
+		double min_time = 0.05;
+		unsigned repetitions = 5;
+		bool tsv = false;
+		std::string baseline{};
+		double tolerance = 0.10;
+	};
+
+	struct result
+	{
+		std::string name;
+		std::size_t operations;
+		double ns_per_op;
+	};
+
+	options parse_options(const int argc, char** const argv)
+	{
+		options opts;
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string arg = argv[i];
+			const auto value = [&]() -> std::string
+			{
+				if (i+1 >= argc)
+				{
+					std::cerr << "Missing value for " << arg << ".\n";
+					std::exit(EXIT_FAILURE);
+				}
+				return argv[++i];
+			};
+
+			if (arg == "--filter")
+				opts.filter = value();
+			else if (arg == "--min-time")
+				opts.min_time = std::stod(value());
+			else if (arg == "--repetitions")
+				opts.repetitions = std::max(1, std::stoi(value()));
+			else if (arg == "--tsv")
+				opts.tsv = true;
+			else if (arg == "--baseline")
+				opts.baseline = value();
+			else if (arg == "--tolerance")
+				opts.tolerance = std::stod(value());
+			else
+			{
+				std::cerr << "Unknown option " << arg << ".\n";
+				std::exit(EXIT_FAILURE);
+			}
+		}
+		return opts;
+	}
+
+	// Grows the batch until one run takes at least min_time, then takes the median of the repetitions.
+	result measure(const benchmark& b, const options& opts)
+	{
+		using clock = std::chrono::steady_clock;
+		const std::chrono::duration<double> min_time(opts.min_time);
+
+		std::size_t batch = 1;
+		for (;;)
+		{
+			const auto start = clock::now();
+			b.run(batch);
+			const auto elapsed = clock::now() - start;
+			if (elapsed >= min_time || batch >= (std::size_t{1} << 30))
+				break;
+			const double scale = min_time / std::max<clock::duration>(elapsed, std::chrono::microseconds(1));
+			batch = std::max(batch*2, static_cast<std::size_t>(batch * scale * 1.2));
+		}
+
+		std::vector<double> samples;
+		std::size_t operations = 0;
+		for (unsigned i = 0; i < opts.repetitions; ++i)
+		{
+			const auto start = clock::now();
+			operations = b.run(batch);
+			const std::chrono::duration<double, std::nano> elapsed = clock::now() - start;
+			samples.push_back(elapsed.count() / std::max<std::size_t>(operations, 1));
+		}
+		std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+		return result{b.name, operations, samples[samples.size()/2]};
+	}
+
+	// Reads the name and ns_per_op of each entry of a file written by print_json.
+	std::map<std::string, double> read_baseline(const std::string& path)
+	{
+		std::ifstream in(path);
+		if (!in)
+		{
+			std::cerr << "Cannot read baseline " << path << ".\n";
+			std::exit(EXIT_FAILURE);
+		}
+
+		std::map<std::string, double> baseline;
+		std::string line;
+		while (std::getline(in, line))
+		{
+			const auto name_key = line.find("\"name\": \"");
+			const auto time_key = line.find("\"ns_per_op\": ");
+			if (name_key == std::string::npos || time_key == std::string::npos)
+				continue;
+			const auto name_begin = name_key + 9;
+			const auto name = line.substr(name_begin, line.find('"', name_begin) - name_begin);
+			baseline[name] = std::stod(line.substr(time_key + 13));
+		}
+		return baseline;
+	}
+
+	void print_json(const std::vector<result>& results)
+	{
+		std::cout << "{\n  \"benchmarks\": [\n";
+		for (std::size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& r = results[i];
+			std::cout << "    { \"name\": \"" << r.name << "\", \"operations\": " << r.operations << ", \"ns_per_op\": " << r.ns_per_op << " }" << (i+1 < results.size() ? "," : "") << '\n';
+		}
+		std::cout << "  ]\n}\n";
+	}
+
+	void print_tsv(const std::vector<result>& results)
+	{
+		std::cout << "name\toperations\tns_per_op\n";
+		for (const auto& r : results)
+			std::cout << r.name << '\t' << r.operations << '\t' << r.ns_per_op << '\n';
+	}
+} // End of anonymous namespace.
+
+int main(const int argc, char** const argv)
+{
+	const options opts = parse_options(argc, argv);
+
+	registry benchmarks;
+	register_utf8_benchmarks(benchmarks);
+	register_driver_benchmarks(benchmarks);
+	register_diff_benchmarks(benchmarks);
+	register_textbox_benchmarks(benchmarks);
+	register_input_benchmarks(benchmarks);
+
+	std::vector<result> results;
+	for (const auto& b : benchmarks.all())
+	{
+		if (b.name.find(opts.filter) == std::string::npos)
+			continue;
+		results.push_back(measure(b, opts));
+		std::cerr << results.back().name << ": " << results.back().ns_per_op << " ns/op\n";
+	}
+
+	if (opts.tsv)
+		print_tsv(results);
+	else
+		print_json(results);
+
+	if (opts.baseline.empty())
+		return EXIT_SUCCESS;
+
+	int status = EXIT_SUCCESS;
+	const auto baseline = read_baseline(opts.baseline);
+	for (const auto& r : results)
+	{
+		const auto it = baseline.find(r.name);
+		if (it == baseline.end())
+			continue;
+		const double change = r.ns_per_op / it->second - 1.0;
+		if (change > opts.tolerance)
+		{
+			std::cerr << "Regression: " << r.name << " is " << change*100 << "% slower than baseline (" << it->second << " -> " << r.ns_per_op << " ns/op).\n";
+			status = EXIT_FAILURE;
+		}
+	}
+	return status;
+}
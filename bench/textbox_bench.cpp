@@ -0,0 +1,137 @@
+//
+// Termwrap
+//
+// bench/textbox_bench.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Editing a textbox with key events: typing, pasting (a burst of key events, as termbox delivers a paste, or one
+// paste event, as the driver decodes a bracketed paste), cursor movement and editing in the middle of a long field.
+// Each textbox is drawn to a headless driver and every event is presented, as an interactive session would.
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+
+#include "bench.hpp"
+#include "../driver/driver.hpp"
+#include "../driver/event.hpp"
+#include "../driver/headless_backend.hpp"
+#include "../driver/key_event.hpp"
+#include "../engine/textbox.hpp"
+
+namespace termwrap::bench
+{
+	namespace
+	{
+		constexpr ordinate_t box_width = 80;
+		constexpr std::size_t box_capacity = 4096;
+
+		std::shared_ptr<driver> make_headless_driver()
+		{
+			auto terminal = std::make_unique<headless_backend>(120, 10);
+			terminal->set_record_output(false);
+			terminal->set_emulate_screen(false);
+			auto d = std::make_shared<driver>(std::move(terminal));
+			d->set_frame_interval(std::chrono::steady_clock::duration::zero());
+			return d;
+		}
+
+		textbox make_textbox(driver& d)
+		{
+			return textbox(d, 0, 0, box_width, box_capacity, cell_style(), cell_style(text_decoration::underline));
+		}
+
+		// Types length characters into an empty textbox, one key event each.
+		void type_text(textbox& box, const std::size_t length)
+		{
+			for (std::size_t i = 0; i < length; ++i)
+				box.accept_key_event(key_event(static_cast<u8char_t>('a' + i%26)));
+		}
+	} // End of anonymous namespace.
+
+	void register_textbox_benchmarks(registry& benchmarks)
+	{
+		// One operation is one keystroke. The textbox is replaced when it fills up.
+		benchmarks.add("textbox/typing", [d = make_headless_driver()](const std::size_t batch)
+		{
+			std::size_t done = 0;
+			while (done < batch)
+			{
+				auto box = make_textbox(*d);
+				const std::size_t length = std::min(batch - done, box_capacity - 1);
+				type_text(box, length);
+				done += length;
+			}
+			return batch;
+		});
+
+		// One operation is a 256-character paste into the middle of the text. The textbox is replaced when it fills up.
+		benchmarks.add("textbox/paste", [d = make_headless_driver()](const std::size_t batch)
+		{
+			constexpr std::size_t paste_length = 256;
+			std::size_t done = 0;
+			while (done < batch)
+			{
+				auto box = make_textbox(*d);
+				type_text(box, paste_length);
+				for (; done < batch && box.get_content().length() + paste_length < box_capacity; ++done)
+				{
+					box.set_cursor_position(box.get_content().length() / 2);
+					type_text(box, paste_length);
+				}
+			}
+			return batch;
+		});
+
+		// The same paste delivered as one paste_event, as the driver reports it with bracketed paste on.
+		benchmarks.add("textbox/paste_event", [d = make_headless_driver()](const std::size_t batch)
+		{
+			constexpr std::size_t paste_length = 256;
+			const event paste = paste_event{string(paste_length, U'p')};
+			std::size_t done = 0;
+			while (done < batch)
+			{
+				auto box = make_textbox(*d);
+				type_text(box, paste_length);
+				for (; done < batch && box.get_content().length() + paste_length < box_capacity; ++done)
+				{
+					box.set_cursor_position(box.get_content().length() / 2);
+					box.accept_event(paste);
+				}
+			}
+			return batch;
+		});
+
+		// One operation is a keystroke and a backspace in the middle of a long field, where every edit used to shift
+		// the rest of the text.
+		benchmarks.add("textbox/edit_middle", [d = make_headless_driver()](const std::size_t batch)
+		{
+			constexpr std::size_t long_capacity = 65536;
+			textbox box(*d, 0, 0, box_width, long_capacity, cell_style(), cell_style(text_decoration::underline));
+			box.set_content(string(long_capacity / 2, U'a'));
+			box.set_cursor_position(long_capacity / 4);
+			for (std::size_t i = 0; i < batch; ++i)
+			{
+				box.accept_key_event(key_event(U'x'));
+				box.accept_key_event(key_event(special_key::backspace));
+			}
+			return batch;
+		});
+
+		// One operation is one arrow or home/end keystroke across a long line.
+		benchmarks.add("textbox/cursor_movement", [d = make_headless_driver()](const std::size_t batch)
+		{
+			auto box = make_textbox(*d);
+			type_text(box, 1024);
+			const key_event keys[] = { key_event(special_key::home), key_event(special_key::arrow_right), key_event(special_key::arrow_right), key_event(special_key::end), key_event(special_key::arrow_left) };
+			for (std::size_t i = 0; i < batch; ++i)
+				box.accept_key_event(keys[i % std::size(keys)]);
+			return batch;
+		});
+	}
+} // End of namespace termwrap::bench.
@@ -0,0 +1,219 @@
+//
+// Termwrap
+//
+// bench/utf8_bench.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// utf8_string and utf8_string_view length, indexing, insertion and erasure on ASCII, CJK and emoji text, and the bulk
+// UTF-8 and search kernels at each instruction set level, and scratch strings built on the heap and on a frame arena.
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "bench.hpp"
+#include "../driver/frame_arena.hpp"
+#include "../driver/simd.hpp"
+#include "../driver/types.hpp"
+#include "../driver/utf8_search.hpp"
+#include "../driver/utf8_simd.hpp"
+
+namespace termwrap::bench
+{
+	namespace
+	{
+		struct corpus
+		{
+			const char* name;
+			const char* sample;
+		};
+
+		// Each sample is repeated to about 4 KiB.
+		constexpr corpus corpora[] = {
+			{ "ascii", "2017-06-01T12:00:00Z INFO request served in 12ms path=/api/v1/items status=200\n" },
+			{ "cjk", "東京都の天気は晴れ、最高気温は二十五度です。서울의 날씨는 맑음。" },
+			{ "emoji", "\xf0\x9f\x98\x80\xf0\x9f\x9a\x80\xf0\x9f\x8e\x89\xf0\x9f\x94\xa5\xf0\x9f\x90\x8d\xf0\x9f\x8c\x88" }
+		};
+
+		std::string make_octets(const corpus& c, const std::size_t size)
+		{
+			std::string octets;
+			while (octets.size() < size)
+				octets += c.sample;
+			return octets;
+		}
+
+		string make_text(const corpus& c)
+		{
+			return string(make_octets(c, 4096));
+		}
+
+		// The text searched for sits at the very end, so that every search is a full pass.
+		constexpr const char* needle = "needle\xe2\x80\xa6";
+		constexpr const char* needle_set = "|\xe2\x80\xa6";
+
+		std::string make_haystack(const corpus& c, const std::size_t size)
+		{
+			return make_octets(c, size) + needle;
+		}
+
+		// One operation is one pass of a kernel over 64 KiB, about what a busy log pane takes in per frame.
+		void register_kernel_benchmarks(registry& benchmarks, const corpus& c)
+		{
+			const simd_level levels[] = { simd_level::scalar, simd_level::sse2, simd_level::sse42, simd_level::avx2 };
+			for (const simd_level level : levels)
+			{
+				if (level > active_simd_level())
+					continue;
+				const std::string suffix = std::string("/") + to_string(level) + "/" + c.name;
+
+				benchmarks.add("utf8_kernel/validate" + suffix, [octets = make_octets(c, 65536), level](const std::size_t batch)
+				{
+					for (std::size_t i = 0; i < batch; ++i)
+						do_not_optimize(utf8_validate(octets.data(), octets.size(), level));
+					return batch;
+				});
+
+				benchmarks.add("utf8_kernel/count" + suffix, [octets = make_octets(c, 65536), level](const std::size_t batch)
+				{
+					for (std::size_t i = 0; i < batch; ++i)
+						do_not_optimize(utf8_count(octets.data(), octets.size(), level));
+					return batch;
+				});
+
+				benchmarks.add("utf8_kernel/decode" + suffix, [octets = make_octets(c, 65536), level](const std::size_t batch)
+				{
+					std::vector<std::uint32_t> code_points(octets.size());
+					for (std::size_t i = 0; i < batch; ++i)
+					{
+						std::size_t consumed = 0;
+						do_not_optimize(utf8_decode(octets.data(), octets.size(), code_points.data(), code_points.size(), consumed, level));
+						do_not_optimize(code_points.data());
+					}
+					return batch;
+				});
+
+				benchmarks.add("utf8_kernel/find" + suffix, [octets = make_haystack(c, 65536), level](const std::size_t batch)
+				{
+					const std::size_t needle_size = std::char_traits<char>::length(needle);
+					for (std::size_t i = 0; i < batch; ++i)
+						do_not_optimize(utf8_find(octets.data(), octets.size(), needle, needle_size, level));
+					return batch;
+				});
+
+				benchmarks.add("utf8_kernel/find_first_of" + suffix, [octets = make_haystack(c, 65536), level](const std::size_t batch)
+				{
+					const std::size_t set_size = std::char_traits<char>::length(needle_set);
+					for (std::size_t i = 0; i < batch; ++i)
+						do_not_optimize(utf8_find_first_of(octets.data(), octets.size(), needle_set, set_size, level));
+					return batch;
+				});
+			}
+		}
+	} // End of anonymous namespace.
+
+	void register_utf8_benchmarks(registry& benchmarks)
+	{
+		for (const corpus& c : corpora)
+		{
+			const std::string suffix = std::string("/") + c.name;
+
+			benchmarks.add("utf8_string/length" + suffix, [text = make_text(c)](const std::size_t batch)
+			{
+				for (std::size_t i = 0; i < batch; ++i)
+				{
+					do_not_optimize(text.length());
+					do_not_optimize(text.data());
+				}
+				return batch;
+			});
+
+			benchmarks.add("utf8_string_view/length" + suffix, [text = make_text(c)](const std::size_t batch)
+			{
+				const string_view view = text;
+				for (std::size_t i = 0; i < batch; ++i)
+				{
+					do_not_optimize(view.length());
+					do_not_optimize(view.data());
+				}
+				return batch;
+			});
+
+			// Indexing strides through the string, as a renderer reading a window at a scroll offset would.
+			benchmarks.add("utf8_string/index" + suffix, [text = make_text(c)](const std::size_t batch)
+			{
+				const auto length = text.length();
+				std::size_t position = 0;
+				for (std::size_t i = 0; i < batch; ++i)
+				{
+					do_not_optimize(text[position]);
+					position = (position + 97) % length;
+				}
+				return batch;
+			});
+
+			benchmarks.add("utf8_string/insert" + suffix, [text = make_text(c)](const std::size_t batch) mutable
+			{
+				const auto middle = text.length() / 2;
+				for (std::size_t i = 0; i < batch; ++i)
+				{
+					text.insert(middle, 1, U'x');
+					text.erase(middle, 1);
+				}
+				do_not_optimize(text.data());
+				return batch;
+			});
+
+			benchmarks.add("utf8_string/erase" + suffix, [text = make_text(c)](const std::size_t batch) mutable
+			{
+				const auto middle = text.length() / 2;
+				for (std::size_t i = 0; i < batch; ++i)
+				{
+					const uint32_t cp = text[middle];
+					text.erase(middle, 1);
+					text.insert(middle, 1, cp);
+				}
+				do_not_optimize(text.data());
+				return batch;
+			});
+
+			// A filter pane searching one 4 KiB line per operation.
+			benchmarks.add("utf8_string_view/find" + suffix, [text = string(make_haystack(c, 4096))](const std::size_t batch)
+			{
+				const string_view view = text;
+				for (std::size_t i = 0; i < batch; ++i)
+					do_not_optimize(view.find(needle));
+				return batch;
+			});
+
+			register_kernel_benchmarks(benchmarks, c);
+		}
+
+		// A row's worth of padding built and dropped once per operation, as a widget does each time it draws.
+		benchmarks.add("utf8_string/scratch/heap", [](const std::size_t batch)
+		{
+			for (std::size_t i = 0; i < batch; ++i)
+			{
+				const string padding(120, ' ');
+				do_not_optimize(padding.data());
+			}
+			return batch;
+		});
+
+		benchmarks.add("utf8_string/scratch/arena", [arena = std::make_shared<frame_arena>()](const std::size_t batch)
+		{
+			for (std::size_t i = 0; i < batch; ++i)
+			{
+				const frame_string padding(120, ' ', arena->allocator<char>());
+				do_not_optimize(padding.data());
+				arena->reset();
+			}
+			return batch;
+		});
+	}
+} // End of namespace termwrap::bench.
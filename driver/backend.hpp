@@ -0,0 +1,63 @@
+//
+// Termwrap
+//
+// termwrap/backend.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// backend is the interface between the driver and whatever it draws on: a real terminal (termbox_backend) or an
+// in-memory screen (headless_backend). The driver owns the cell buffers and encodes frames; a backend only reports
+// its size, accepts encoded output and supplies input.
+
+#ifndef RHC_TERMWRAP_BACKEND_H
+#define RHC_TERMWRAP_BACKEND_H
+
+#include <cstddef>
+#include <optional>
+
+#include "cell_style.hpp"
+#include "event.hpp"
+#include "key_event.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	class backend
+	{
+	public:
+		virtual ~backend() = default;
+
+		virtual ordinate_t width() const = 0;
+		virtual ordinate_t height() const = 0;
+
+		// True if the screen is blanked when its size changes, so nothing drawn before the resize survives.
+		virtual bool clears_on_resize() const = 0;
+
+		// The colours the terminal can show.
+		virtual color_depth colors() const = 0;
+
+		// Writes one encoded frame.
+		virtual void write(const char* const octets, const std::size_t count) = 0;
+
+		// Writes a control sequence outside any frame, such as one that turns a terminal mode on or off.
+		virtual void write_control(const char* const octets, const std::size_t count) = 0;
+
+		// Waits up to wait_ms for input, a key_event or mouse_event. Returns nothing on a timeout or on other input,
+		// such as a resize; the driver checks the size after every poll.
+		virtual std::optional<event> poll_event(const unsigned wait_ms) = 0;
+
+		// Mouse events are reported only while this is on.
+		virtual void set_mouse_reporting(const bool enable) = 0;
+
+		// A descriptor that is readable while input is waiting, for an event_loop to wait on, or -1 if there is none.
+		virtual int input_fd() const = 0;
+
+		// Rereads the size of the terminal, when something other than poll_event has learned that it changed. If the
+		// size did change and clears_on_resize() is true, the screen is blanked here too.
+		virtual void refresh_size() = 0;
+	}; // End of class backend.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_BACKEND_H.
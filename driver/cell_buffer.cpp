@@ -0,0 +1,113 @@
+//
+// Termwrap
+//
+// termwrap/cell_buffer.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "cell_buffer.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace termwrap
+{
+	cell_buffer::cell_buffer(const ordinate_t width, const ordinate_t height)
+		: columns(width), rows(height),
+		  code_points(std::size_t{width}*height, blank_code_point),
+		  styles(std::size_t{width}*height, blank_style)
+	{ }
+
+	void cell_buffer::resize(const ordinate_t width, const ordinate_t height)
+	{
+		if (width == columns && height == rows)
+			return;
+
+		// Rows are contiguous, so a change of height alone keeps the cells where they are.
+		if (width == columns)
+		{
+			code_points.resize(std::size_t{width}*height, blank_code_point);
+			styles.resize(std::size_t{width}*height, blank_style);
+			rows = height;
+			return;
+		}
+
+		cell_buffer resized(width, height);
+		const ordinate_t overlap_width = std::min(width, columns);
+		const ordinate_t overlap_height = std::min(height, rows);
+		for (ordinate_t y = 0; y < overlap_height; ++y)
+		{
+			std::copy_n(code_point_row(y), overlap_width, resized.code_point_row(y));
+			std::copy_n(style_row(y), overlap_width, resized.style_row(y));
+		}
+		*this = std::move(resized);
+	}
+
+	void cell_buffer::clear()
+	{
+		std::fill(code_points.begin(), code_points.end(), blank_code_point);
+		std::fill(styles.begin(), styles.end(), blank_style);
+	}
+
+	void cell_buffer::invalidate()
+	{
+		std::fill(code_points.begin(), code_points.end(), invalid_code_point);
+	}
+
+	void cell_buffer::mark_styles(std::vector<bool>& live) const
+	{
+		for (const style_id_t id : styles)
+			live[id] = true;
+	}
+
+	void cell_buffer::remap_styles(const std::vector<style_id_t>& map) noexcept
+	{
+		for (style_id_t& id : styles)
+			id = map[id];
+	}
+
+	void cell_buffer::copy_span(const cell_buffer& other, const ordinate_t min_x, const ordinate_t max_x, const ordinate_t y) noexcept
+	{
+		const std::size_t count = max_x - min_x + 1;
+		std::copy_n(other.code_point_row(y) + min_x, count, code_point_row(y) + min_x);
+		std::copy_n(other.style_row(y) + min_x, count, style_row(y) + min_x);
+	}
+
+	// Four cells are compared per step: two 64-bit words of code points and one of style IDs.
+	// Only a block containing a difference is searched cell by cell.
+	ordinate_t cell_buffer::next_difference(const cell_buffer& other, const ordinate_t y, ordinate_t min_x, const ordinate_t max_x) const noexcept
+	{
+		constexpr ordinate_t cells_per_step = 4;
+
+		const u8char_t* const cp = code_point_row(y);
+		const u8char_t* const other_cp = other.code_point_row(y);
+		const style_id_t* const st = style_row(y);
+		const style_id_t* const other_st = other.style_row(y);
+
+		const auto load = [](const void* const p)
+		{
+			std::uint64_t word;
+			std::memcpy(&word, p, sizeof(word));
+			return word;
+		};
+
+		for (; min_x + cells_per_step - 1 <= max_x; min_x += cells_per_step)
+		{
+			const std::uint64_t delta = (load(cp + min_x) ^ load(other_cp + min_x))
+				| (load(cp + min_x + 2) ^ load(other_cp + min_x + 2))
+				| (load(st + min_x) ^ load(other_st + min_x));
+			if (delta)
+				break;
+		}
+
+		for (; min_x <= max_x; ++min_x)
+		{
+			if (cp[min_x] != other_cp[min_x] || st[min_x] != other_st[min_x])
+				return min_x;
+		}
+		return max_x + 1;
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,82 @@
+//
+// Termwrap
+//
+// termwrap/cell_buffer.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// cell_buffer is termwrap's own screen buffer. Code points and style IDs (see style_table.hpp) are held in separate
+// packed planes, so style-only operations touch only the 16-bit style plane and buffers can be compared a machine word
+// at a time.
+
+#ifndef RHC_TERMWRAP_CELL_BUFFER_H
+#define RHC_TERMWRAP_CELL_BUFFER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "style_table.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	class cell_buffer
+	{
+		ordinate_t columns = 0;
+		ordinate_t rows = 0;
+
+		std::vector<u8char_t> code_points{};
+		std::vector<style_id_t> styles{};
+
+	public:
+		static constexpr u8char_t blank_code_point = ' ';
+		static constexpr style_id_t blank_style = style_table::default_id;
+		// Not a code point, so no cell drawn can match it.
+		static constexpr u8char_t invalid_code_point = 0xffffffff;
+
+		cell_buffer() = default;
+		cell_buffer(const ordinate_t width, const ordinate_t height);
+
+		// Resizes the buffer, keeping the overlapping region and blanking any newly exposed cells.
+		void resize(const ordinate_t width, const ordinate_t height);
+		void clear();
+		// Marks every cell as unlike anything that could be drawn, for a front buffer whose cells must all be sent
+		// again.
+		void invalidate();
+
+		// For style_table::compact: marks the style IDs in use, then renumbers them by the map it returns.
+		void mark_styles(std::vector<bool>& live) const;
+		void remap_styles(const std::vector<style_id_t>& map) noexcept;
+
+		ordinate_t width() const noexcept { return columns; }
+		ordinate_t height() const noexcept { return rows; }
+
+		std::size_t index(const ordinate_t x, const ordinate_t y) const noexcept { return std::size_t{y}*columns + x; }
+
+		u8char_t* code_point_row(const ordinate_t y) noexcept { return code_points.data() + index(0, y); }
+		const u8char_t* code_point_row(const ordinate_t y) const noexcept { return code_points.data() + index(0, y); }
+		style_id_t* style_row(const ordinate_t y) noexcept { return styles.data() + index(0, y); }
+		const style_id_t* style_row(const ordinate_t y) const noexcept { return styles.data() + index(0, y); }
+
+		u8char_t code_point(const ordinate_t x, const ordinate_t y) const noexcept { return code_points[index(x, y)]; }
+		style_id_t style(const ordinate_t x, const ordinate_t y) const noexcept { return styles[index(x, y)]; }
+
+		void set(const ordinate_t x, const ordinate_t y, const u8char_t ch, const style_id_t style) noexcept
+		{
+			const auto i = index(x, y);
+			code_points[i] = ch;
+			styles[i] = style;
+		}
+
+		// Copies cells min_x to max_x inclusive of row y from another buffer of the same geometry.
+		void copy_span(const cell_buffer& other, const ordinate_t min_x, const ordinate_t max_x, const ordinate_t y) noexcept;
+
+		// Returns the first x in [min_x, max_x] at which row y differs from the same row of other, or max_x+1 if the
+		// span is identical. The buffers must have the same geometry.
+		ordinate_t next_difference(const cell_buffer& other, const ordinate_t y, ordinate_t min_x, const ordinate_t max_x) const noexcept;
+	}; // End of class cell_buffer.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_CELL_BUFFER_H.
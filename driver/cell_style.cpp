@@ -8,108 +8,132 @@
 //
 
 #include "cell_style.hpp"
-#include "error.hpp"
-#include "/opt/termbox/include/termbox.h"
+
+#include <cstddef>
+#include <cstdint>
 
 namespace termwrap
 {
-	static constexpr native_style_t to_native_color(const color& c)
+	namespace
 	{
-		switch (c)
+		struct rgb
+		{
+			int red;
+			int green;
+			int blue;
+		};
+
+		template <std::size_t N, class T>
+		struct table
 		{
-			case color::unset:
-				return TB_DEFAULT;
-			case color::white:
-				return TB_WHITE;
-			case color::black:
-				return TB_BLACK;
-			case color::red:
-				return TB_RED;
-			case color::green:
-				return TB_GREEN;
-			case color::yellow:
-				return TB_YELLOW;
-			case color::blue:
-				return TB_BLUE;
-			case color::magenta:
-				return TB_MAGENTA;
-			case color::cyan:
-				return TB_CYAN;
-			// ...
-			default:
-				throw color_not_supported_error();
+			T entries[N];
+			constexpr const T& operator[](const std::size_t i) const noexcept { return entries[i]; }
+		};
+
+		// The usual xterm values of the sixteen ANSI colours. The rest of the palette is a 6x6x6 colour cube and a
+		// ramp of 24 greys.
+		constexpr rgb ansi_colors[16] = {
+			{ 0, 0, 0 }, { 205, 0, 0 }, { 0, 205, 0 }, { 205, 205, 0 }, { 0, 0, 238 }, { 205, 0, 205 }, { 0, 205, 205 }, { 229, 229, 229 },
+			{ 127, 127, 127 }, { 255, 0, 0 }, { 0, 255, 0 }, { 255, 255, 0 }, { 92, 92, 255 }, { 255, 0, 255 }, { 0, 255, 255 }, { 255, 255, 255 }
+		};
+		constexpr int cube_levels[6] = { 0, 95, 135, 175, 215, 255 };
+		constexpr int cube_base = 16;
+		constexpr int grey_base = 232;
+
+		constexpr int grey_level(const int step) noexcept
+		{
+			return 8 + 10*step;
 		}
-	}
 
-	static constexpr color to_color(const native_style_t native_style)
-	{
-		switch(native_style & 0xff)
+		constexpr int distance(const rgb& a, const rgb& b) noexcept
 		{
-			case TB_DEFAULT:
-				return color::unset;
-			case TB_WHITE:
-				return color::white;
-			case TB_BLACK:
-				return color::black;
-			case TB_RED:
-				return color::red;
-			case TB_GREEN:
-				return color::green;
-			case TB_YELLOW:
-				return color::yellow;
-			case TB_BLUE:
-				return color::blue;
-			case TB_MAGENTA:
-				return color::magenta;
-			case TB_CYAN:
-				return color::cyan;
-			// ...
-			default:
-				throw color_not_supported_error();
+			return (a.red-b.red)*(a.red-b.red) + (a.green-b.green)*(a.green-b.green) + (a.blue-b.blue)*(a.blue-b.blue);
 		}
-		//__builtin_unreachable();
-	}
 
-	static constexpr native_style_t to_native_weight(const font_weight& w)
-	{
-		switch (w)
+		constexpr table<256, rgb> make_palette()
 		{
-			case font_weight::normal:
-				return 0x0;
-			case font_weight::bold:
-				return TB_BOLD;
+			table<256, rgb> palette{};
+			for (int i = 0; i < 16; ++i)
+				palette.entries[i] = ansi_colors[i];
+			for (int i = 0; i < 216; ++i)
+				palette.entries[cube_base + i] = rgb{ cube_levels[i/36], cube_levels[i/6 % 6], cube_levels[i % 6] };
+			for (int i = 0; i < 24; ++i)
+				palette.entries[grey_base + i] = rgb{ grey_level(i), grey_level(i), grey_level(i) };
+			return palette;
 		}
-		__builtin_unreachable();
-	}
 
-	static constexpr native_style_t to_native_decoration(const text_decoration& d)
-	{
-		switch (d)
+		// For each channel value, the nearest level of the cube (cube) or step of the grey ramp (grey).
+		constexpr table<256, std::uint8_t> make_nearest_levels(const bool grey)
 		{
-			case text_decoration::normal:
-				return 0x0;
-			case text_decoration::underline:
-				return TB_UNDERLINE;
+			table<256, std::uint8_t> nearest{};
+			for (int v = 0; v < 256; ++v)
+			{
+				const int steps = grey ? 24 : 6;
+				int best = 0;
+				for (int step = 1; step < steps; ++step)
+				{
+					const int level = grey ? grey_level(step) : cube_levels[step];
+					const int best_level = grey ? grey_level(best) : cube_levels[best];
+					if ((level-v)*(level-v) < (best_level-v)*(best_level-v))
+						best = step;
+				}
+				nearest.entries[v] = static_cast<std::uint8_t>(best);
+			}
+			return nearest;
 		}
-		__builtin_unreachable();
-	}
-	
-	cell_style::cell_style(const native_style_t fg, const native_style_t bg)
-	{
-		foreground = to_color(fg);
-		background = to_color(bg);
-		weight = font_weight::normal;
-		decoration = text_decoration::normal;
-	}
 
-	native_style_t cell_style::to_native_fg() const 
-	{
-		return to_native_color(foreground) | to_native_weight(weight) | to_native_decoration(decoration);
-	}
+		constexpr auto palette = make_palette();
+		constexpr auto cube_steps = make_nearest_levels(false);
+		constexpr auto grey_steps = make_nearest_levels(true);
+
+		// For each palette entry, the nearest of the first count entries.
+		constexpr table<256, std::uint8_t> make_reduction(const int count)
+		{
+			table<256, std::uint8_t> nearest{};
+			for (int i = 0; i < 256; ++i)
+			{
+				int best = 0;
+				for (int candidate = 1; candidate < count; ++candidate)
+				{
+					if (distance(palette[candidate], palette[i]) < distance(palette[best], palette[i]))
+						best = candidate;
+				}
+				nearest.entries[i] = static_cast<std::uint8_t>((i < count) ? i : best);
+			}
+			return nearest;
+		}
+
+		constexpr auto to_bright = make_reduction(16);
+		constexpr auto to_basic = make_reduction(8);
 
-	native_style_t cell_style::to_native_bg() const
+		// The palette entry nearest an RGB colour: the nearer of the closest cube entry and the closest grey, each
+		// found a channel at a time by table lookup.
+		constexpr std::uint8_t nearest_palette_index(const rgb& c) noexcept
+		{
+			const int cube = cube_base + 36*cube_steps[c.red] + 6*cube_steps[c.green] + cube_steps[c.blue];
+			const int grey = grey_base + grey_steps[(c.red + c.green + c.blue) / 3];
+			return static_cast<std::uint8_t>((distance(palette[cube], c) <= distance(palette[grey], c)) ? cube : grey);
+		}
+
+		static_assert(nearest_palette_index(rgb{ 255, 0, 0 }) == 196);
+		static_assert(nearest_palette_index(rgb{ 128, 128, 128 }) == 244);
+		static_assert(to_basic[196] == 1 && to_bright[196] == 9);
+	} // End of anonymous namespace.
+
+	native_style_t native_style::reduce(const native_style_t native, const color_depth depth) noexcept
 	{
-		return to_native_color(background);
+		const native_style_t kind = native & kind_mask;
+		if (depth == color_depth::truecolor || kind == default_color)
+			return native;
+
+		std::uint8_t index = static_cast<std::uint8_t>(native);
+		if (kind == rgb_color)
+			index = nearest_palette_index(rgb{ static_cast<std::uint8_t>(native >> 16), static_cast<std::uint8_t>(native >> 8), index });
+
+		if (depth == color_depth::bright)
+			index = to_bright[index];
+		else if (depth == color_depth::basic)
+			index = to_basic[index];
+		return (native & ~color_mask) | from_palette(index);
 	}
 } // End of namespace termwrap.
-
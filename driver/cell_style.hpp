@@ -1,5 +1,5 @@
 //
-// Termwrap 
+// Termwrap
 //
 // termwrap/cell_style.hpp
 //
@@ -10,7 +10,10 @@
 #ifndef RHC_TERMWRAP_CELL_STYLE_H
 #define RHC_TERMWRAP_CELL_STYLE_H
 
+#include <cstddef>
 #include <cstdint>
+#include <iterator>
+#include <type_traits>
 
 namespace termwrap
 {
@@ -43,25 +46,144 @@ namespace termwrap
 		underline
 	};
 
-	using native_style_t = std::uint16_t;
-
-	struct cell_style
+	// How many colours a terminal can show. Colours beyond its depth are drawn as the nearest colour it has.
+	enum class color_depth
 	{
-		cell_style() { }
-		cell_style(const font_weight w) : weight(w) { }
-		cell_style(const text_decoration d) : decoration(d) { }
-
-		cell_style(const native_style_t fg, const native_style_t bg);
-		
-		color foreground {};
-		color background {};
-		font_weight weight {};
-		text_decoration decoration {};
-
-		native_style_t to_native_fg() const ;
-		native_style_t to_native_bg() const ;
+		basic,		// The eight ANSI colours.
+		bright,		// The eight ANSI colours and their bright forms.
+		palette,	// The xterm 256-colour palette.
+		truecolor	// 24-bit RGB.
 	};
+
+	// One half of a style: a colour in the low bits and, in the foreground word, the font attributes above it. Every
+	// colour is stored exactly and styles compare as integers.
+	using native_style_t = std::uint32_t;
+
+	namespace native_style
+	{
+		// A colour is the terminal's default, an index into the 256-colour palette, or 24-bit RGB.
+		constexpr native_style_t color_mask = 0x03ffffff;
+		constexpr native_style_t kind_mask = 0x03000000;
+		constexpr native_style_t default_color = 0x00000000;
+		constexpr native_style_t palette_color = 0x01000000;
+		constexpr native_style_t rgb_color = 0x02000000;
+
+		constexpr native_style_t bold = 0x04000000;
+		constexpr native_style_t underline = 0x08000000;
+		constexpr native_style_t reverse = 0x10000000;
+
+		constexpr native_style_t from_palette(const std::uint8_t index) noexcept
+		{
+			return palette_color | index;
+		}
+		constexpr native_style_t from_rgb(const std::uint8_t red, const std::uint8_t green, const std::uint8_t blue) noexcept
+		{
+			return rgb_color | (native_style_t{red} << 16) | (native_style_t{green} << 8) | blue;
+		}
+
+		// Palette indices of the named colours, indexed by color.
+		constexpr std::int16_t named_colors[] = { -1, 7, 0, 1, 2, 3, 4, 5, 6 };
+
+		constexpr native_style_t from_color(const color c) noexcept
+		{
+			const auto index = static_cast<std::size_t>(c);
+			return (index < std::size(named_colors) && named_colors[index] >= 0) ? from_palette(named_colors[index]) : default_color;
+		}
+
+		// The nearest colour to a native colour that a terminal of the given depth can show. The result keeps any
+		// attribute bits of the argument. Uses lookup tables; see cell_style.cpp.
+		native_style_t reduce(const native_style_t native, const color_depth depth) noexcept;
+	} // End of namespace native_style.
+
+	// Any colour a cell can have: one of the named colours, an entry of the 256-colour palette, or 24-bit RGB. The
+	// named colours are palette entries 0 to 7, so color::red and color_value::palette(1) are the same colour.
+	class color_value
+	{
+		native_style_t native = native_style::default_color;
+
+		constexpr explicit color_value(const native_style_t native, int ) noexcept : native(native & native_style::color_mask) { }
+
+	public:
+		constexpr color_value() noexcept = default;
+		constexpr color_value(const color c) noexcept : native(native_style::from_color(c)) { }
+
+		static constexpr color_value palette(const std::uint8_t index) noexcept { return color_value(native_style::from_palette(index), 0); }
+		static constexpr color_value rgb(const std::uint8_t red, const std::uint8_t green, const std::uint8_t blue) noexcept
+		{
+			return color_value(native_style::from_rgb(red, green, blue), 0);
+		}
+		// The colour of a native plane word, ignoring its attribute bits.
+		static constexpr color_value from_native(const native_style_t native) noexcept { return color_value(native, 0); }
+
+		constexpr bool is_default() const noexcept { return native == native_style::default_color; }
+		constexpr bool is_palette() const noexcept { return (native & native_style::kind_mask) == native_style::palette_color; }
+		constexpr bool is_rgb() const noexcept { return (native & native_style::kind_mask) == native_style::rgb_color; }
+
+		constexpr std::uint8_t palette_index() const noexcept { return static_cast<std::uint8_t>(native); }
+		constexpr std::uint8_t red() const noexcept { return static_cast<std::uint8_t>(native >> 16); }
+		constexpr std::uint8_t green() const noexcept { return static_cast<std::uint8_t>(native >> 8); }
+		constexpr std::uint8_t blue() const noexcept { return static_cast<std::uint8_t>(native); }
+
+		constexpr native_style_t to_native() const noexcept { return native; }
+
+		friend constexpr bool operator==(const color_value& a, const color_value& b) noexcept { return a.native == b.native; }
+		friend constexpr bool operator!=(const color_value& a, const color_value& b) noexcept { return a.native != b.native; }
+	}; // End of class color_value.
+
+	// A style is held as its native foreground and background words, packed into one integer: it is converted when it
+	// is built or changed, never when it is drawn, and two styles are compared (or hashed by style_table) in one
+	// instruction.
+	class cell_style
+	{
+		std::uint64_t packed = 0;
+
+		static constexpr std::uint64_t pack(const native_style_t fg, const native_style_t bg) noexcept
+		{
+			return fg | (std::uint64_t{bg} << 32);
+		}
+
+	public:
+		constexpr cell_style() noexcept = default;
+		constexpr cell_style(const font_weight w) noexcept : cell_style(color::unset, color::unset, w) { }
+		constexpr cell_style(const text_decoration d) noexcept : cell_style(color::unset, color::unset, font_weight::normal, d) { }
+		constexpr cell_style(const color_value fg, const color_value bg, const font_weight w = font_weight::normal, const text_decoration d = text_decoration::normal) noexcept
+			: packed(pack(fg.to_native() | ((w == font_weight::bold) ? native_style::bold : 0) | ((d == text_decoration::underline) ? native_style::underline : 0), bg.to_native()))
+		{ }
+
+		// Adopts native words as they are, so that a style read back from a cell is the style it was drawn with.
+		constexpr cell_style(const native_style_t fg, const native_style_t bg) noexcept : packed(pack(fg, bg)) { }
+
+		constexpr color_value foreground() const noexcept { return color_value::from_native(to_native_fg()); }
+		constexpr color_value background() const noexcept { return color_value::from_native(to_native_bg()); }
+		constexpr font_weight weight() const noexcept { return (to_native_fg() & native_style::bold) ? font_weight::bold : font_weight::normal; }
+		constexpr text_decoration decoration() const noexcept { return (to_native_fg() & native_style::underline) ? text_decoration::underline : text_decoration::normal; }
+
+		constexpr void set_foreground(const color_value c) noexcept
+		{
+			packed = pack((to_native_fg() & ~native_style::color_mask) | c.to_native(), to_native_bg());
+		}
+		constexpr void set_background(const color_value c) noexcept
+		{
+			packed = pack(to_native_fg(), c.to_native());
+		}
+		constexpr void set_weight(const font_weight w) noexcept
+		{
+			packed = (w == font_weight::bold) ? (packed | native_style::bold) : (packed & ~std::uint64_t{native_style::bold});
+		}
+		constexpr void set_decoration(const text_decoration d) noexcept
+		{
+			packed = (d == text_decoration::underline) ? (packed | native_style::underline) : (packed & ~std::uint64_t{native_style::underline});
+		}
+
+		constexpr native_style_t to_native_fg() const noexcept { return static_cast<native_style_t>(packed); }
+		constexpr native_style_t to_native_bg() const noexcept { return static_cast<native_style_t>(packed >> 32); }
+		constexpr std::uint64_t to_packed() const noexcept { return packed; }
+
+		friend constexpr bool operator==(const cell_style& a, const cell_style& b) noexcept { return a.packed == b.packed; }
+		friend constexpr bool operator!=(const cell_style& a, const cell_style& b) noexcept { return a.packed != b.packed; }
+	}; // End of class cell_style.
+
+	static_assert(std::is_trivially_copyable_v<cell_style> && sizeof(cell_style) == sizeof(std::uint64_t));
 } // End of namespace termwrap.
 
 #endif // !RHC_TERMWRAP_CELL_STYLE_H
-
@@ -0,0 +1,126 @@
+//
+// Termwrap
+//
+// termwrap/damage_tracker.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// damage_tracker records which cells of the back buffer have changed since the last present, as a single dirty
+// span per row. Spans only ever grow until the tracker is cleared, so marking a cell is O(1).
+
+#ifndef RHC_TERMWRAP_DAMAGE_TRACKER_H
+#define RHC_TERMWRAP_DAMAGE_TRACKER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <limits>
+#include <vector>
+
+#include "types.hpp"
+
+namespace termwrap
+{
+	struct row_span
+	{
+		ordinate_t min_x = std::numeric_limits<ordinate_t>::max();
+		ordinate_t max_x = 0;
+
+		bool empty() const noexcept { return min_x > max_x; }
+		std::size_t size() const noexcept { return empty() ? 0 : max_x - min_x + 1; }
+	};
+
+	class damage_tracker
+	{
+		std::vector<row_span> rows{};
+		ordinate_t column_count = 0;
+
+		// Bounding rows of the damaged region; min_y > max_y when nothing is damaged.
+		ordinate_t min_y = std::numeric_limits<ordinate_t>::max();
+		ordinate_t max_y = 0;
+
+	public:
+		// Damage within the new size is kept and damage cut off is forgotten. Cells the new size exposes are not
+		// marked; the caller marks what needs drawing.
+		void resize(const ordinate_t width, const ordinate_t height)
+		{
+			column_count = width;
+			rows.resize(height, row_span{});
+
+			const ordinate_t old_min_y = min_y;
+			const ordinate_t old_max_y = max_y;
+			min_y = std::numeric_limits<ordinate_t>::max();
+			max_y = 0;
+			for (ordinate_t y = old_min_y; y <= old_max_y && y < height; ++y)
+			{
+				row_span& row = rows[y];
+				if (row.empty())
+					continue;
+				if (row.min_x >= width)
+				{
+					row = row_span{};
+					continue;
+				}
+				row.max_x = std::min<ordinate_t>(row.max_x, width-1);
+				min_y = std::min(min_y, y);
+				max_y = std::max(max_y, y);
+			}
+		}
+
+		ordinate_t width() const noexcept { return column_count; }
+		ordinate_t height() const noexcept { return static_cast<ordinate_t>(rows.size()); }
+
+		// Marks cells min_x to max_x inclusive of row y as damaged.
+		void mark(const ordinate_t min_x, const ordinate_t max_x, const ordinate_t y) noexcept
+		{
+			if (min_x > max_x || y >= rows.size() || min_x >= column_count)
+				return;
+			row_span& row = rows[y];
+			row.min_x = std::min(row.min_x, min_x);
+			row.max_x = std::max<ordinate_t>(row.max_x, std::min<ordinate_t>(max_x, column_count-1));
+			min_y = std::min(min_y, y);
+			max_y = std::max(max_y, y);
+		}
+
+		// Marks an inclusive rectangle as damaged.
+		void mark(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y) noexcept
+		{
+			const ordinate_t last_y = std::min<ordinate_t>(max_y, height()-1);
+			for (ordinate_t y = min_y; y <= last_y && y >= min_y; ++y)
+				mark(min_x, max_x, y);
+		}
+
+		void mark_all() noexcept
+		{
+			if (column_count > 0 && !rows.empty())
+				mark(0, 0, column_count-1, height()-1);
+		}
+
+		void clear() noexcept
+		{
+			if (empty())
+				return;
+			std::fill(rows.begin()+min_y, rows.begin()+max_y+1, row_span{});
+			min_y = std::numeric_limits<ordinate_t>::max();
+			max_y = 0;
+		}
+
+		bool empty() const noexcept { return min_y > max_y; }
+
+		ordinate_t first_row() const noexcept { return min_y; }
+		ordinate_t last_row() const noexcept { return max_y; }
+		const row_span& row(const ordinate_t y) const noexcept { return rows[y]; }
+
+		// Number of damaged cells.
+		std::size_t cell_count() const noexcept
+		{
+			std::size_t count = 0;
+			for (ordinate_t y = min_y; y <= max_y && !empty(); ++y)
+				count += rows[y].size();
+			return count;
+		}
+	}; // End of class damage_tracker.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_DAMAGE_TRACKER_H.
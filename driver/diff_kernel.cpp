@@ -0,0 +1,187 @@
+//
+// Termwrap
+//
+// termwrap/diff_kernel.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "diff_kernel.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RHC_TERMWRAP_X86 1
+#endif
+
+namespace termwrap
+{
+	namespace
+	{
+		struct row_planes
+		{
+			const u8char_t* code_points;
+			const style_id_t* styles;
+
+			row_planes(const cell_buffer& buffer, const ordinate_t y)
+				: code_points(buffer.code_point_row(y)), styles(buffer.style_row(y))
+			{ }
+		};
+
+		bool cell_differs(const row_planes& a, const row_planes& b, const ordinate_t x) noexcept
+		{
+			return a.code_points[x] != b.code_points[x] || a.styles[x] != b.styles[x];
+		}
+
+		// Folds the changed-cell mask of a block of count cells starting at base into the run list. A run still
+		// open at the end of the previous block is extended rather than restarted.
+		void fold_block(std::uint64_t changed, const unsigned count, const ordinate_t base, std::vector<cell_run>& runs, bool& open)
+		{
+			unsigned i = 0;
+			while (i < count)
+			{
+				if (changed & 1)
+				{
+					const unsigned length = std::min<unsigned>(__builtin_ctzll(~changed), count - i);
+					if (open)
+						runs.back().end += length;
+					else
+						runs.push_back(cell_run{static_cast<ordinate_t>(base + i), static_cast<ordinate_t>(base + i + length)});
+					open = (i + length == count);
+					i += length;
+					changed >>= length;
+				}
+				else
+				{
+					open = false;
+					if (changed == 0)
+						return;
+					const unsigned gap = __builtin_ctzll(changed);
+					i += gap;
+					changed >>= gap;
+				}
+			}
+		}
+
+		// Finishes a row cell by cell from x, continuing any open run.
+		void diff_tail(const row_planes& a, const row_planes& b, ordinate_t x, const ordinate_t max_x, std::vector<cell_run>& runs, bool open)
+		{
+			for (; x <= max_x; ++x)
+			{
+				if (!cell_differs(a, b, x))
+					open = false;
+				else if (open)
+					++runs.back().end;
+				else
+				{
+					runs.push_back(cell_run{x, static_cast<ordinate_t>(x + 1)});
+					open = true;
+				}
+			}
+		}
+
+		void diff_row_scalar(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs)
+		{
+			const row_planes a(back, y);
+			const row_planes b(front, y);
+			while (min_x <= max_x)
+			{
+				min_x = back.next_difference(front, y, min_x, max_x);
+				if (min_x > max_x)
+					break;
+				const ordinate_t begin = min_x;
+				while (min_x <= max_x && cell_differs(a, b, min_x))
+					++min_x;
+				runs.push_back(cell_run{begin, min_x});
+			}
+		}
+
+#ifdef RHC_TERMWRAP_X86
+		__attribute__((target("sse2")))
+		inline __m128i load128(const void* const p)
+		{
+			return _mm_loadu_si128(static_cast<const __m128i*>(p));
+		}
+
+		__attribute__((target("avx2")))
+		inline __m256i load256(const void* const p)
+		{
+			return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+		}
+
+		// Eight cells per step: two vectors of code points packed down to 16-bit lanes and combined with the style
+		// IDs, then narrowed to one bit per cell.
+		__attribute__((target("sse2")))
+		void diff_row_sse2(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, ordinate_t x, const ordinate_t max_x, std::vector<cell_run>& runs)
+		{
+			const row_planes a(back, y);
+			const row_planes b(front, y);
+
+			bool open = false;
+			for (; x + 7 <= max_x; x += 8)
+			{
+				const __m128i cp_low = _mm_cmpeq_epi32(load128(a.code_points + x), load128(b.code_points + x));
+				const __m128i cp_high = _mm_cmpeq_epi32(load128(a.code_points + x + 4), load128(b.code_points + x + 4));
+				const __m128i style = _mm_cmpeq_epi16(load128(a.styles + x), load128(b.styles + x));
+				const __m128i equal = _mm_and_si128(_mm_packs_epi32(cp_low, cp_high), style);
+				const std::uint64_t changed = ~_mm_movemask_epi8(_mm_packs_epi16(equal, equal)) & 0xff;
+				if (changed)
+					fold_block(changed, 8, x, runs, open);
+				else
+					open = false;
+			}
+			diff_tail(a, b, x, max_x, runs, open);
+		}
+
+		// Sixteen cells per step. The in-lane pack interleaves the code point halves, so a cross-lane permute
+		// restores cell order before combining with the style IDs.
+		__attribute__((target("avx2")))
+		void diff_row_avx2(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, ordinate_t x, const ordinate_t max_x, std::vector<cell_run>& runs)
+		{
+			const row_planes a(back, y);
+			const row_planes b(front, y);
+
+			bool open = false;
+			for (; x + 15 <= max_x; x += 16)
+			{
+				const __m256i cp_low = _mm256_cmpeq_epi32(load256(a.code_points + x), load256(b.code_points + x));
+				const __m256i cp_high = _mm256_cmpeq_epi32(load256(a.code_points + x + 8), load256(b.code_points + x + 8));
+				const __m256i cp = _mm256_permute4x64_epi64(_mm256_packs_epi32(cp_low, cp_high), 0xd8);
+				const __m256i style = _mm256_cmpeq_epi16(load256(a.styles + x), load256(b.styles + x));
+				const __m256i equal = _mm256_and_si256(cp, style);
+				const std::uint32_t mask = _mm256_movemask_epi8(_mm256_packs_epi16(equal, equal));
+				const std::uint64_t changed = ~((mask & 0xff) | ((mask >> 8) & 0xff00)) & 0xffff;
+				if (changed)
+					fold_block(changed, 16, x, runs, open);
+				else
+					open = false;
+			}
+			diff_tail(a, b, x, max_x, runs, open);
+		}
+#endif
+	} // End of anonymous namespace.
+
+	void diff_row(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs, const simd_level level)
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return diff_row_avx2(back, front, y, min_x, max_x, runs);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return diff_row_sse2(back, front, y, min_x, max_x, runs);
+#endif
+			default:
+				return diff_row_scalar(back, front, y, min_x, max_x, runs);
+		}
+	}
+
+	void diff_row(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs)
+	{
+		diff_row(back, front, y, min_x, max_x, runs, active_simd_level());
+	}
+} // End of namespace termwrap.
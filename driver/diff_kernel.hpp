@@ -0,0 +1,38 @@
+//
+// Termwrap
+//
+// termwrap/diff_kernel.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// The diff kernel compares a row span of the back buffer with the front buffer and reports the runs of cells that
+// have changed. It is the hot loop of presentation, so it is vectorized (SSE2, AVX2) with a scalar fallback,
+// chosen at runtime.
+
+#ifndef RHC_TERMWRAP_DIFF_KERNEL_H
+#define RHC_TERMWRAP_DIFF_KERNEL_H
+
+#include <vector>
+
+#include "cell_buffer.hpp"
+#include "simd.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	// A run of changed cells [begin, end) within one row.
+	struct cell_run
+	{
+		ordinate_t begin;
+		ordinate_t end;
+	};
+
+	// Appends to runs the changed cells of row y between min_x and max_x inclusive, in ascending order. Both
+	// buffers must have the same geometry.
+	void diff_row(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs);
+	void diff_row(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const ordinate_t min_x, const ordinate_t max_x, std::vector<cell_run>& runs, const simd_level level);
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_DIFF_KERNEL_H.
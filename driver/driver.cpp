@@ -9,43 +9,48 @@
 
 #include "driver.hpp"
 
+#include <algorithm>
 #include <cassert>
 #include <chrono>
 #include <cstdint>
 #include <iostream>
 #include <optional>
+#include <memory>
+#include <string_view>
 
-#include "/opt/termbox/include/termbox.h"
+#include "fill_kernel.hpp"
+#include "termbox_backend.hpp"
 #include "types.hpp"
+#include "utf8_simd.hpp"
 
 namespace termwrap
 {
 	//
-	// Driver implementation (wrapper around termbox).
+	// Driver implementation. Drawing goes into termwrap's own buffers; the backend (termbox by default) only
+	// carries encoded frames out and input in.
 	//
 
 	driver::driver()
+		: driver(std::make_unique<termbox_backend>())
+	{ }
+
+	driver::driver(std::unique_ptr<backend> terminal)
+		: terminal(std::move(terminal))
 	{
-		int tb_status = tb_init();
-		if (tb_status < 0)
-		{
-			switch (tb_status)
-			{
-				case TB_EUNSUPPORTED_TERMINAL:
-					throw unsupported_terminal_error();
-				case TB_EFAILED_TO_OPEN_TTY:
-					throw failed_to_open_terminal_error();
-				case TB_EPIPE_TRAP_ERROR:
-					throw pipe_trap_error();
-				default:
-					throw driver_unknown_error();
-			}
-		}
+		resize_buffers(this->terminal->width(), this->terminal->height());
+		damage.mark_all();
+		encoder.set_color_depth(this->terminal->colors());
+		set_bracketed_paste(true);
 	}
 
 	driver::~driver()
 	{
-		tb_shutdown();
+		try
+		{
+			set_bracketed_paste(false);
+		}
+		catch (...)
+		{ }
 	}
 
 	//driver::driver(driver&& other)
@@ -56,12 +61,150 @@ namespace termwrap
 	// Terminal painting.
 	void driver::clear()
 	{
-		tb_clear();
+		back.clear();
+		damage.mark_all();
 	}
 
 	void driver::redraw()
 	{
-		tb_present();
+		frame_requested = true;
+		if (std::chrono::steady_clock::now() - last_present >= frame_interval)
+			flush_now();
+	}
+
+	// Presents the frame if anything was damaged since the last one. Within the damaged spans, the diff kernel finds
+	// the runs of cells that differ from the front buffer; the encoder turns those into escape sequences, and the
+	// whole frame goes to the terminal in one write. The frame arena is reset either way, as a frame that changed
+	// nothing may still have built scratch strings.
+	void driver::flush_now()
+	{
+		frame_requested = false;
+		sync_geometry();
+
+		if (damage.empty() && !cursor_moved)
+		{
+			frame_dirty_cells = 0;
+			arena.reset();
+			return;
+		}
+
+		frame_dirty_cells = damage.cell_count();
+		for (ordinate_t y = damage.first_row(); y <= damage.last_row(); ++y)
+		{
+			const row_span& span = damage.row(y);
+			if (span.empty())
+				continue;
+
+			changed_runs.clear();
+			diff_row(back, front, y, span.min_x, span.max_x, changed_runs);
+			for (const cell_run& run : changed_runs)
+			{
+				encoder.write_run(back, front, y, run, styles);
+				front.copy_span(back, run.begin, run.end-1, y);
+			}
+		}
+		encoder.place_cursor(cursor_visible, cursor_x, cursor_y, front);
+		write_output();
+		last_present = std::chrono::steady_clock::now();
+		damage.clear();
+		cursor_moved = false;
+		arena.reset();
+	}
+
+	void driver::write_output()
+	{
+		try
+		{
+			terminal->write(encoder.data(), encoder.size());
+		}
+		catch (...)
+		{
+			encoder.clear();
+			encoder.reset();
+			throw;
+		}
+		encoder.clear();
+	}
+
+	// The buffers keep their overlapping cells when the terminal changes size. If the backend blanked the screen,
+	// the front buffer is blanked to match, the encoder forgets the cursor and pen, and everything is damaged.
+	// Otherwise the terminal still shows the overlap, so only the cells the new size exposes are damaged.
+	void driver::sync_geometry()
+	{
+		const ordinate_t width = terminal->width();
+		const ordinate_t height = terminal->height();
+		const ordinate_t old_width = back.width();
+		const ordinate_t old_height = back.height();
+		if (old_width == width && old_height == height)
+			return;
+
+		resize_buffers(width, height);
+		if (terminal->clears_on_resize())
+		{
+			front.clear();
+			encoder.reset();
+			damage.mark_all();
+		}
+		else
+		{
+			const ordinate_t kept_height = std::min(height, old_height);
+			if (width > old_width && kept_height > 0)
+				damage.mark(old_width, 0, width-1, kept_height-1);
+			if (height > old_height)
+				damage.mark(0, old_height, width-1, height-1);
+		}
+
+		// A cursor left outside the terminal is moved to the nearest cell.
+		if (width > 0 && height > 0 && (cursor_x >= width || cursor_y >= height))
+		{
+			cursor_x = std::min<ordinate_t>(cursor_x, width-1);
+			cursor_y = std::min<ordinate_t>(cursor_y, height-1);
+			cursor_moved = true;
+		}
+		announce_resize(old_width, old_height);
+	}
+
+	void driver::resize_buffers(const ordinate_t width, const ordinate_t height)
+	{
+		back.resize(width, height);
+		front.resize(width, height);
+		damage.resize(width, height);
+	}
+
+	// A resize still waiting to be handed out is updated rather than followed by another. The callbacks are called
+	// through copies, so that they may add or remove callbacks.
+	void driver::announce_resize(const ordinate_t old_width, const ordinate_t old_height)
+	{
+		const ordinate_t width = back.width();
+		const ordinate_t height = back.height();
+		resize_event* const pending = pending_events.empty() ? nullptr : std::get_if<resize_event>(&pending_events.back());
+		if (pending)
+		{
+			pending->width = width;
+			pending->height = height;
+		}
+		else
+			pending_events.push_back(resize_event{width, height, old_width, old_height});
+
+		if (width != old_width)
+		{
+			const auto callbacks = width_callbacks;
+			for (const auto& callback : callbacks)
+				callback.second(width, old_width);
+		}
+		if (height != old_height)
+		{
+			const auto callbacks = height_callbacks;
+			for (const auto& callback : callbacks)
+				callback.second(height, old_height);
+		}
+	}
+
+	void driver::remove_callback(const callback_id id)
+	{
+		const auto matches = [id](const std::pair<callback_id, resize_callback>& callback) { return callback.first == id; };
+		width_callbacks.erase(std::remove_if(width_callbacks.begin(), width_callbacks.end(), matches), width_callbacks.end());
+		height_callbacks.erase(std::remove_if(height_callbacks.begin(), height_callbacks.end(), matches), height_callbacks.end());
 	}
 
 	// Cell-level display.
@@ -72,106 +215,231 @@ namespace termwrap
 
 	cell_style driver::get_cell_style(const ordinate_t x, const ordinate_t y) const
 	{
-		const struct tb_cell* const native_buffer = tb_cell_buffer();
-		const struct tb_cell* const cell = native_buffer + y*console_width() + x;
-		const cell_style style {cell->fg, cell->bg};
-		return style;
+		check_coordinates(x, y);
+		return styles[back.style(x, y)];
 	}
 
 	u8char_t driver::get_cell_text(const ordinate_t x, const ordinate_t y) const
 	{
-		const struct tb_cell* const native_buffer = tb_cell_buffer();
-		const struct tb_cell* const cell = native_buffer + y*console_width() + x;
-		return cell->ch;
+		check_coordinates(x, y);
+		return back.code_point(x, y);
+	}
+
+	// A full table is compacted to the styles on the screen, and in the frame being drawn, and tried again. Both
+	// buffers are renumbered alike, so the diff is unaffected; the encoder's caches by ID are dropped.
+	style_id_t driver::intern_style(const cell_style& style)
+	{
+		try
+		{
+			return styles.intern(style);
+		}
+		catch (const style_table_full_error& )
+		{
+			std::vector<bool> live(styles.size(), false);
+			back.mark_styles(live);
+			front.mark_styles(live);
+			const std::vector<style_id_t> map = styles.compact(live);
+			back.remap_styles(map);
+			front.remap_styles(map);
+			encoder.forget_styles();
+		}
+		return styles.intern(style);
 	}
 
 	void driver::set_cell(const ordinate_t x, const ordinate_t y, const u8char_t ch, const cell_style& style)
 	{
-		tb_change_cell(x, y, ch, style.to_native_fg(), style.to_native_bg());
+		check_coordinates(x, y);
+		back.set(x, y, ch, intern_style(style));
+		damage.mark(x, x, y);
+	}
+
+	void driver::check_coordinates(const ordinate_t x, const ordinate_t y) const
+	{
+		if (x >= back.width() || y >= back.height())
+			throw terminal_coord_invalid_error();
+	}
+
+	// A run of n octets holds at most n code points, so text is only decoded to measure it when it might not fit.
+	static bool fits_within(const string_view& text, const ordinate_t available)
+	{
+		return text.octet_size() <= available || text.length() <= available;
+	}
+
+	// Writes text into row y of the back buffer from x up to max_x inclusive, copying ASCII or decoding anything
+	// else straight into the code point plane. The style is interned once and its ID filled into the style plane for
+	// the whole span; a null style leaves the existing cell styles alone.
+	// Advances x past the last cell written and returns the number of octets of text consumed.
+	string_view::size_type driver::write_span(ordinate_t& x, const ordinate_t y, const ordinate_t max_x, const string_view& text, const cell_style* const style)
+	{
+		const ordinate_t start_x = x;
+		const std::size_t available = (x <= max_x) ? max_x - x + 1 : 0;
+		std::size_t consumed = 0;
+		if (text.is_ascii())
+		{
+			// One octet per cell: a straight widening copy with no decoding.
+			consumed = std::min(text.octet_size(), available);
+			const auto octets = reinterpret_cast<const unsigned char*>(text.data());
+			std::copy(octets, octets + consumed, back.code_point_row(y) + x);
+			x += consumed;
+		}
+		else
+			x += utf8_decode(text.data(), text.octet_size(), back.code_point_row(y) + x, available, consumed);
+
+		if (x > start_x)
+		{
+			if (style)
+			{
+				std::fill(back.style_row(y) + start_x, back.style_row(y) + x, intern_style(*style));
+			}
+			damage.mark(start_x, x-1, y);
+		}
+		return consumed;
 	}
 
 	void driver::write_at(ordinate_t x, const ordinate_t y, const string_view& text, const cell_style& style)
 	{
-		if (text.length() > console_width() - x)
+		const ordinate_t width = console_width();
+		if (y >= console_height())
+			throw terminal_coord_invalid_error();
+		if (x > width || !fits_within(text, width - x))
 			throw text_overflow_error();
-		for (const auto& ch : text)
-			tb_change_cell(x++, y, ch, style.to_native_fg(), style.to_native_bg());
+		write_span(x, y, width-1, text, &style);
 	}
 
 	void driver::write_at(ordinate_t x, const ordinate_t y, const string_view& text)
 	{
-		if (text.length() > console_width() - x)
+		const ordinate_t width = console_width();
+		if (y >= console_height())
+			throw terminal_coord_invalid_error();
+		if (x > width || !fits_within(text, width - x))
 			throw text_overflow_error();
-		for (const auto& ch : text)
-		{
-			const struct tb_cell* const native_buffer = tb_cell_buffer();
-			const struct tb_cell* const cell = native_buffer + y*console_width() + x;
-			tb_change_cell(x, y, ch, cell->fg, cell->bg);
-			x++;
-		}
+		write_span(x, y, width-1, text, nullptr);
 	}
 
 	void driver::write_block_at(const ordinate_t start_x, const ordinate_t start_y, const string_view& text)
+	{
+		write_block(start_x, start_y, console_width()-1, console_height()-1, text);
+	}
+
+	void driver::write_block_at(const ordinate_t start_x, const ordinate_t start_y, const ordinate_t max_y, const string_view& text)
+	{
+		write_block(start_x, start_y, console_width()-1, std::min<ordinate_t>(max_y, console_height()-1), text);
+	}
+
+	void driver::write_block_at(const ordinate_t start_x, const ordinate_t start_y, const ordinate_t max_x, const ordinate_t max_y, const string_view& text)
+	{
+		write_block(start_x, start_y, std::min<ordinate_t>(max_x, console_width()-1), std::min<ordinate_t>(max_y, console_height()-1), text);
+	}
+
+	void driver::write_block(const ordinate_t start_x, const ordinate_t start_y, const ordinate_t max_x, const ordinate_t max_y, const string_view& text)
 	{
 		ordinate_t x = start_x; ordinate_t y = start_y;
-		const auto width = console_width();
+		const char* const first = text.data();
+		const char* octet = first;
+		const char* const last = octet + text.octet_size();
+		// Settled once for the whole block, so that each run below inherits it rather than scanning again.
+		text.is_ascii();
 
-		for (const auto& ch : text)
+		while (octet != last)
 		{
-			switch (ch)
+			switch (*octet)
 			{
 				case '\n':
 					++y;
 					// [[fall_through]
 				case '\r':
 					x = start_x;
+					++octet;
 					continue;
 				case '\t':
 					x += tab_stop_width;
 					x = (x/tab_stop_width)*tab_stop_width;
+					++octet;
 					continue;
 			}
 
-			if (x >= console_width())
+			if (x > max_x)
 			{
 				x = start_x;
 				++y;
 			}
 
-			if (y >= console_height())
+			if (y > max_y)
 				throw text_overflow_error();
 
-			const struct tb_cell* const native_buffer = tb_cell_buffer();
-			const struct tb_cell* const cell = native_buffer + y*width + x;
-			tb_change_cell(x, y, ch, cell->fg, cell->bg);
-
-			++x;
+			// Control characters never occur inside a multi-octet sequence, so everything up to the next one is a
+			// printable run that can go to the row as a single span.
+			const char* const run_end = std::find_if(octet, last, [](const char c) { return c == '\n' || c == '\r' || c == '\t'; });
+			octet += write_span(x, y, max_x, text.octet_substr(octet-first, run_end-octet), nullptr);
 		}
-
 	}
 
+	// Style-only: leaves the code points alone. Cells off the edge of the terminal are ignored.
 	void driver::set_block_style(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const cell_style& style)
 	{
-		const struct tb_cell* const native_buffer = tb_cell_buffer();
-		const ordinate_t width = console_width();
-		for (ordinate_t y = min_y; y <= max_y; ++y)
+		style_rect(min_x, min_y, max_x, max_y, style);
+	}
+
+	void driver::fill_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const u8char_t ch, const cell_style& style)
+	{
+		fill_cells(min_x, min_y, max_x, max_y, &ch, style);
+	}
+
+	void driver::clear_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y)
+	{
+		fill_cells(min_x, min_y, max_x, max_y, &cell_buffer::blank_code_point, cell_style());
+	}
+
+	void driver::style_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const cell_style& style)
+	{
+		fill_cells(min_x, min_y, max_x, max_y, nullptr, style);
+	}
+
+	// Fills each clipped row of the code point plane (unless ch is null) and of the style plane with the fill kernel,
+	// which skips vectors already holding the value. Only the rows from the first to the last that changed are
+	// damaged, in one mark.
+	void driver::fill_cells(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const u8char_t* const ch, const cell_style& style)
+	{
+		if (min_x >= back.width() || min_y >= back.height() || min_x > max_x || min_y > max_y)
+			return;
+
+		const ordinate_t last_x = std::min<ordinate_t>(max_x, back.width()-1);
+		const ordinate_t last_y = std::min<ordinate_t>(max_y, back.height()-1);
+		const std::size_t count = last_x - min_x + 1;
+		const style_id_t id = intern_style(style);
+
+		ordinate_t first_changed = last_y + 1;
+		ordinate_t last_changed = 0;
+		for (ordinate_t y = min_y; y <= last_y; ++y)
 		{
-			for (ordinate_t x = min_x; x <= max_x; ++x)
+			bool changed = fill_span(back.style_row(y) + min_x, count, id);
+			if (ch)
+				changed = fill_span(back.code_point_row(y) + min_x, count, *ch) || changed;
+			if (changed)
 			{
-				const struct tb_cell* const cell = native_buffer + y*width + x;
-				tb_change_cell(x, y, cell->ch, style.to_native_fg(), style.to_native_bg());
+				first_changed = std::min(first_changed, y);
+				last_changed = y;
 			}
 		}
+		if (first_changed <= last_changed)
+			damage.mark(min_x, first_changed, last_x, last_changed);
 	}
 
+	// The geometry of the back buffer, which follows the terminal once a resize has been seen.
 	ordinate_t driver::console_height() const
 	{
-		return tb_height();
+		return back.height();
 	}
 
 	ordinate_t driver::console_width() const
 	{
-		return tb_width();
+		return back.width();
+	}
+
+	void driver::refresh_geometry()
+	{
+		terminal->refresh_size();
+		sync_geometry();
 	}
 
 	/*native_char_t driver::to_native_char(const char ch)
@@ -194,174 +462,180 @@ namespace termwrap
 
 	void driver::hide_cursor()
 	{
-		tb_set_cursor(TB_HIDE_CURSOR, TB_HIDE_CURSOR);
+		cursor_moved |= cursor_visible;
+		cursor_visible = false;
 	}
 
 	void driver::set_cursor_position(const ordinate_t x, const ordinate_t y)
 	{
-		tb_set_cursor(x, y);
+		cursor_moved |= !cursor_visible || x != cursor_x || y != cursor_y;
+		cursor_visible = true;
+		cursor_x = x;
+		cursor_y = y;
 	}
 
-	std::optional<key_event> driver::wait_for_key_event_impl(const unsigned wait_ms)
+	void driver::set_color_depth(const color_depth depth)
 	{
-		struct tb_event native_event{};
+		if (depth == encoder.get_color_depth())
+			return;
+		encoder.set_color_depth(depth);
+		front.invalidate();
+		damage.mark_all();
+	}
 
-		const int state = tb_peek_event(&native_event, wait_ms);
+	void driver::set_bracketed_paste(const bool enable)
+	{
+		if (enable == bracketed_paste)
+			return;
+		static constexpr char enable_sequence[] = "\x1b[?2004h";
+		static constexpr char disable_sequence[] = "\x1b[?2004l";
+		terminal->write_control(enable ? enable_sequence : disable_sequence, sizeof(enable_sequence) - 1);
+		bracketed_paste = enable;
+	}
 
-		if (state < 0)
-			throw failed_peek_poll_event();
-		if (state == 0)
-			return {};
-		if (state != TB_EVENT_KEY)
+	// Events the input thread has read but not handed out are taken before it is stopped.
+	void driver::set_input_thread(const bool enable)
+	{
+		if (enable == get_input_thread())
+			return;
+
+		if (enable)
+		{
+			auto threaded = std::make_unique<threaded_backend>(std::move(terminal));
+			input_thread = threaded.get();
+			terminal = std::move(threaded);
+			return;
+		}
+
+		std::unique_ptr<backend> unwrapped = input_thread->release();
+		while (std::optional<event> input = terminal->poll_event(0))
+			accept_input(std::move(*input));
+		terminal = std::move(unwrapped);
+		input_thread = nullptr;
+	}
+
+	void driver::set_mouse_reporting(const bool enable)
+	{
+		terminal->set_mouse_reporting(enable);
+		mouse_reporting = enable;
+	}
+
+	std::optional<event> driver::poll_input(const unsigned wait_ms)
+	{
+		std::optional<event> input;
+
+		// Input that is already queued is handed out before a deferred frame is presented, so a burst such as a
+		// paste coalesces into one frame. Once the queue is dry the loop is idle and the frame goes out before
+		// blocking.
+		if (frame_requested)
+		{
+			input = terminal->poll_event(0);
+			if (!input)
+				flush_now();
+		}
+		if (!input)
+			input = terminal->poll_event(wait_ms);
+
+		sync_geometry();
+		return input;
+	}
+
+	// Key events go through the paste decoder, which may hold some back. While it holds what may be the start of a
+	// paste, the rest of the sequence is waited for only briefly; if nothing comes, the held key events were just
+	// keys.
+	std::optional<event> driver::wait_for_event_impl(const unsigned wait_ms)
+	{
+		while (pending_events.empty())
+		{
+			std::optional<event> input = poll_input(paste.holding() ? paste_start_wait_ms : wait_ms);
+			if (!input)
+			{
+				paste.flush(pending_events);
+				break;
+			}
+			accept_input(std::move(*input));
+		}
+
+		if (pending_events.empty())
 			return {};
+		return take_pending_event();
+	}
 
-		const bool alt = false; //native_event.mod & TB_MOD_ALT;
+	// Everything pending is read before anything is handed out, so a paste that has fully arrived comes out whole.
+	// A partial start sequence held back is given a little time to finish, as the input thread may still be passing
+	// it on; if the terminal has nothing more, it was just keys.
+	std::size_t driver::drain_events(std::vector<event>& events)
+	{
+		while (std::optional<event> input = terminal->poll_event(paste.holding() ? paste_start_wait_ms : 0))
+			accept_input(std::move(*input));
+		sync_geometry();
+		if (!paste.in_paste())
+			paste.flush(pending_events);
+
+		const std::size_t count = pending_events.size();
+		while (!pending_events.empty())
+			events.push_back(take_pending_event());
+		if (count == 0 && frame_requested)
+			flush_now();
+		return count;
+	}
 
-		if (native_event.ch)
-			return key_event(native_event.ch, false, alt);
+	void driver::accept_input(event&& input)
+	{
+		if (const auto key = std::get_if<key_event>(&input))
+		{
+			if (bracketed_paste || paste.in_paste())
+				paste.feed(*key, pending_events);
+			else
+				pending_events.push_back(*key);
+		}
+		else
+		{
+			// Anything else ends a start sequence, but may come in the middle of a paste.
+			if (!paste.in_paste())
+				paste.flush(pending_events);
+			pending_events.push_back(std::move(input));
+		}
+	}
 
-		switch (native_event.key)
+	// Key events are rebound by the keymap as they are handed out.
+	event driver::take_pending_event()
+	{
+		event next = std::move(pending_events.front());
+		pending_events.pop_front();
+		if (const auto key = std::get_if<key_event>(&next))
+			*key = keys.translate(*key);
+		return next;
+	}
+
+	std::optional<key_event> driver::wait_for_key_event_impl(const unsigned wait_ms)
+	{
+		if (pending_keys.empty())
 		{
-			case TB_KEY_ESC:
-				return key_event(special_key::escape, false, alt);
-			case TB_KEY_F1:
-				return key_event(special_key::F1, false, alt);
-			case TB_KEY_F2:
-				return key_event(special_key::F2, false, alt);
-			case TB_KEY_F3:
-				return key_event(special_key::F3, false, alt);
-			case TB_KEY_F4:
-				return key_event(special_key::F4, false, alt);
-			case TB_KEY_F5:
-				return key_event(special_key::F5, false, alt);
-			case TB_KEY_F6:
-				return key_event(special_key::F6, false, alt);
-			case TB_KEY_F7:
-				return key_event(special_key::F7, false, alt);
-			case TB_KEY_F8:
-				return key_event(special_key::F8, false, alt);
-			case TB_KEY_F9:
-				return key_event(special_key::F9, false, alt);
-			case TB_KEY_F10:
-				return key_event(special_key::F10, false, alt);
-			case TB_KEY_F11:
-				return key_event(special_key::F11, false, alt);
-			case TB_KEY_F12:
-				return key_event(special_key::F12, false, alt);
-
-			case TB_KEY_INSERT:
-				return key_event(special_key::insert, false, alt);
-			case TB_KEY_DELETE:
-				return key_event(special_key::del, false, alt);
-			case TB_KEY_HOME:
-				return key_event(special_key::home, false, alt);
-			case TB_KEY_END:
-				return key_event(special_key::end, false, alt);
-			case TB_KEY_PGUP:
-				return key_event(special_key::page_up, false, alt);
-			case TB_KEY_PGDN:
-				return key_event(special_key::page_down, false, alt);
-
-			case TB_KEY_ARROW_UP:
-				return key_event(special_key::arrow_up, false, alt);
-			case TB_KEY_ARROW_DOWN:
-				return key_event(special_key::arrow_down, false, alt);
-			case TB_KEY_ARROW_LEFT:
-				return key_event(special_key::arrow_left, false, alt);
-			case TB_KEY_ARROW_RIGHT:
-				return key_event(special_key::arrow_right, false, alt);
-
-			case TB_KEY_ENTER:
-				return key_event(special_key::enter, false, alt);
-			case TB_KEY_SPACE:
-				return key_event(' ', false, alt);
-			case TB_KEY_TAB:
-				return key_event(special_key::tab, false, alt);
-			case TB_KEY_BACKSPACE2:
-			case TB_KEY_BACKSPACE:
-				return key_event(special_key::backspace, false, alt);
-
-			case TB_KEY_CTRL_A:
-				return key_event('A', true, alt);
-			case TB_KEY_CTRL_B:
-				return key_event('B', true, alt);
-			case TB_KEY_CTRL_C:
-				return key_event('C', true, alt);
-			case TB_KEY_CTRL_D:
-				return key_event('D', true, alt);
-			case TB_KEY_CTRL_E:
-				return key_event('E', true, alt);
-			case TB_KEY_CTRL_F:
-				return key_event('F', true, alt);
-			case TB_KEY_CTRL_G:
-				return key_event('G', true, alt);
-			//case TB_KEY_CTRL_H:
-			//	return key_event('H', true, alt);
-			//case TB_KEY_CTRL_I:
-			//	return key_event('I', true, alt);
-			case TB_KEY_CTRL_J:
-				return key_event('J', true, alt);
-			case TB_KEY_CTRL_K:
-				return key_event('K', true, alt);
-			case TB_KEY_CTRL_L:
-				return key_event('L', true, alt);
-			//case TB_KEY_CTRL_M:
-			//	return key_event('M', true, alt);
-			case TB_KEY_CTRL_N:
-				return key_event('N', true, alt);
-			case TB_KEY_CTRL_O:
-				return key_event('O', true, alt);
-			case TB_KEY_CTRL_P:
-				return key_event('P', true, alt);
-			case TB_KEY_CTRL_Q:
-				return key_event('Q', true, alt);
-			case TB_KEY_CTRL_R:
-				return key_event('R', true, alt);
-			case TB_KEY_CTRL_S:
-				return key_event('S', true, alt);
-			case TB_KEY_CTRL_T:
-				return key_event('T', true, alt);
-			case TB_KEY_CTRL_U:
-				return key_event('U', true, alt);
-			case TB_KEY_CTRL_V:
-				return key_event('V', true, alt);
-			case TB_KEY_CTRL_W:
-				return key_event('W', true, alt);
-			case TB_KEY_CTRL_X:
-				return key_event('X', true, alt);
-			case TB_KEY_CTRL_Y:
-				return key_event('Y', true, alt);
-			case TB_KEY_CTRL_Z:
-				return key_event('Z', true, alt);
-
-			//case TB_KEY_CTRL_TILDE:
-			//	return key_event('~', true, alt);
-			case TB_KEY_CTRL_2:
-				return key_event('2', true, alt);
-			//case TB_KEY_CTRL_3:
-			//	return key_event('3', true, alt);
-			case TB_KEY_CTRL_4:
-				return key_event('4', true, alt);
-			case TB_KEY_CTRL_5:
-				return key_event('5', true, alt);
-			case TB_KEY_CTRL_6:
-				return key_event('6', true, alt);
-			case TB_KEY_CTRL_7:
-				return key_event('7', true, alt);
-			//case TB_KEY_CTRL_8:
-			//	return key_event('8', true, alt);
-
-			//case TB_KEY_CTRL_BACKSLASH:
-			//	return key_event('\\', true, alt);
-			//case TB_KEY_CTRL_SLASH:
-			//	return key_event('/', true, alt);
-			//case TB_KEY_CTRL_UNDERSCORE:
-			//	return key_event('_', true, alt);
-
-			default:
-				assert(false);
+			std::optional<event> next = wait_for_event_impl(wait_ms);
+			if (!next)
+				return {};
+			if (const auto key = std::get_if<key_event>(&*next))
+				return *key;
+			if (!std::holds_alternative<paste_event>(*next))
+				return {};
+
+			for (const u8char_t cp : std::get<paste_event>(*next).text)
+			{
+				if (cp == '\n')
+					pending_keys.emplace_back(special_key::enter);
+				else if (cp == '\t')
+					pending_keys.emplace_back(special_key::tab);
+				else
+					pending_keys.emplace_back(cp);
+			}
+			if (pending_keys.empty())
+				return {};
 		}
-		return {};
+
+		const key_event key = pending_keys.front();
+		pending_keys.pop_front();
+		return key;
 	}
 
 } // End of namespace termwrap.
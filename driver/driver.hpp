@@ -12,12 +12,27 @@
 
 #include <chrono>
 #include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
 #include <optional>
 #include <string_view>
+#include <vector>
 
+#include "backend.hpp"
+#include "cell_buffer.hpp"
 #include "cell_style.hpp"
+#include "damage_tracker.hpp"
+#include "diff_kernel.hpp"
 #include "key_event.hpp"
 #include "error.hpp"
+#include "event.hpp"
+#include "frame_arena.hpp"
+#include "keymap.hpp"
+#include "output_encoder.hpp"
+#include "paste_decoder.hpp"
+#include "style_table.hpp"
+#include "threaded_backend.hpp"
 #include "types.hpp"
 
 namespace termwrap
@@ -29,7 +44,12 @@ namespace termwrap
 	class driver
 	{
 	public:
+		// Called with the new and the old width, or height, when the terminal changes size.
+		using resize_callback = std::function<void(const ordinate_t size, const ordinate_t old_size)>;
+		using callback_id = std::uint64_t;
+
 		driver();
+		explicit driver(std::unique_ptr<backend> terminal);
 		~driver();
 
 		driver(const driver& ) = delete;
@@ -38,8 +58,21 @@ namespace termwrap
 		driver& operator=(driver&& other);
 
 		// Screen painting.
+		// redraw() requests a present and coalesces requests to at most one frame per frame interval; a deferred
+		// frame goes out on a later redraw() once the interval has elapsed, when wait_for_key_event finds no input
+		// pending, or when it falls due in an event_loop. flush_now() presents immediately.
 		void clear();
 		void redraw();
+		void flush_now();
+
+		void set_frame_interval(const std::chrono::steady_clock::duration interval) noexcept { frame_interval = interval; }
+		std::chrono::steady_clock::duration get_frame_interval() const noexcept { return frame_interval; }
+		bool frame_pending() const noexcept { return frame_requested; }
+		// When a pending frame may next be presented.
+		std::chrono::steady_clock::time_point next_frame_time() const noexcept { return last_present + frame_interval; }
+
+		// Number of cells damaged in the most recently presented frame.
+		std::size_t dirty_cell_count() const noexcept { return frame_dirty_cells; }
 
 		// Line display.		
 		void write_at(ordinate_t x, const ordinate_t y, const string_view& text);
@@ -51,6 +84,13 @@ namespace termwrap
 		void write_block_at(ordinate_t x, ordinate_t y, ordinate_t max_x, ordinate_t max_y, const string_view& text);
 		void set_block_style(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const cell_style& style);
 
+		// Rectangle display. Each sets every cell of an inclusive rectangle, clipped to the terminal, a row at a time:
+		// fill_rect to one character and style, clear_rect to blanks in the default style, and style_rect to one
+		// style, leaving the text alone. Cells that already hold the value are not rewritten, and a rectangle that
+		// changes nothing damages nothing.
+		void fill_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const u8char_t ch, const cell_style& style);
+		void clear_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y);
+		void style_rect(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const cell_style& style);
 		
 		// Cell-level display.
 		void set_cell_style(const ordinate_t x, const ordinate_t y, const cell_style& style);
@@ -61,6 +101,9 @@ namespace termwrap
 		// Terminal properties.
 		ordinate_t console_height() const;
 		ordinate_t console_width() const;
+		// Has the backend reread the terminal size and resizes the buffers to match, for an event loop that has
+		// learned of a resize itself. Otherwise the size is checked whenever input is polled or a frame presented.
+		void refresh_geometry();
 		/*bool supports_16_bit_color() const;
 		bool supports_256_bit_color() const;
 		bool supports_bold() const;*/
@@ -71,10 +114,113 @@ namespace termwrap
 		void hide_cursor();
 		void set_cursor_position(const ordinate_t x, const ordinate_t y);
 		
+		backend& get_backend() noexcept { return *terminal; }
+
+		// The colours frames are encoded for, as reported by the backend unless overridden. Colours beyond the depth
+		// are drawn as the nearest the terminal has; cells keep their exact colours. Changing the depth redraws
+		// every cell.
+		void set_color_depth(const color_depth depth);
+		color_depth get_color_depth() const noexcept { return encoder.get_color_depth(); }
+
+		// Bracketed paste mode, on by default, has the terminal mark pasted text so that it can be delivered as one
+		// paste_event by wait_for_event.
+		void set_bracketed_paste(const bool enable);
+		bool get_bracketed_paste() const noexcept { return bracketed_paste; }
+
+		// Mouse reporting, off by default, delivers mouse_events through wait_for_event.
+		void set_mouse_reporting(const bool enable);
+		bool get_mouse_reporting() const noexcept { return mouse_reporting; }
+
+		// The input thread, off by default, reads and decodes input on a thread of its own (see threaded_backend), so
+		// that input is never held up by drawing. Its latency counts the time from an event being read to its being
+		// handed to the driver, and is zero while the thread is off. Set this before making an event_loop, which waits
+		// on the input fd it finds when it is made.
+		void set_input_thread(const bool enable);
+		bool get_input_thread() const noexcept { return input_thread != nullptr; }
+		input_latency get_input_latency() const noexcept { return input_thread ? input_thread->get_latency() : input_latency{}; }
+
+		// Key events are passed through the keymap as they are handed out; pasted text is not.
+		keymap& get_keymap() noexcept { return keys; }
+		const keymap& get_keymap() const noexcept { return keys; }
+
+		// Every style drawn is interned here, and cells hold its ID. Interning a style ahead of time does not change
+		// how it is drawn; it only saves the lookup when it is. The table holds at most style_table::max_styles
+		// styles. When a draw finds it full, it is compacted to the styles the back and front buffers still hold,
+		// which renumbers the IDs, so an ID taken from it is good only until the next draw. Only a screen holding
+		// that many distinct styles at once makes a draw throw style_table_full_error.
+		style_table& get_style_table() noexcept { return styles; }
+		const style_table& get_style_table() const noexcept { return styles; }
+
+		// Scratch memory for the frame being drawn, reclaimed by flush_now() whether or not the frame had anything to
+		// present. Strings built on it (frame_string) must not outlive the call that draws them.
+		frame_arena& get_frame_arena() noexcept { return arena; }
+
 	private:
+		std::unique_ptr<backend> terminal;
+		// The terminal, if it is wrapped by the input thread.
+		threaded_backend* input_thread = nullptr;
+
+		// The back buffer is drawn into; the front buffer holds what has been handed to the terminal.
+		cell_buffer back{};
+		cell_buffer front{};
+		damage_tracker damage{};
+		style_table styles{};
+		std::vector<cell_run> changed_runs{};
+		output_encoder encoder{};
+		frame_arena arena{};
+		std::size_t frame_dirty_cells = 0;
+
+		std::chrono::steady_clock::duration frame_interval = std::chrono::milliseconds(16);
+		std::chrono::steady_clock::time_point last_present{};
+		bool frame_requested = false;
+
+		bool bracketed_paste = false;
+		bool mouse_reporting = false;
+		paste_decoder paste{};
+		// How long the rest of a paste's start sequence is waited for while the paste decoder holds its beginning. The
+		// terminal sends it all at once, but the input thread may not have passed it all on yet.
+		static constexpr unsigned paste_start_wait_ms = 20;
+		keymap keys{};
+		std::deque<event> pending_events{};
+		std::deque<key_event> pending_keys{};
+
+		std::vector<std::pair<callback_id, resize_callback>> width_callbacks{};
+		std::vector<std::pair<callback_id, resize_callback>> height_callbacks{};
+		callback_id next_callback_id = 1;
+
+		bool cursor_visible = false;
+		bool cursor_moved = false;
+		ordinate_t cursor_x = 0;
+		ordinate_t cursor_y = 0;
+
+		style_id_t intern_style(const cell_style& style);
+		void sync_geometry();
+		void resize_buffers(const ordinate_t width, const ordinate_t height);
+		void announce_resize(const ordinate_t old_width, const ordinate_t old_height);
+		void write_output();
+		void check_coordinates(const ordinate_t x, const ordinate_t y) const;
+
+		// Span-oriented back buffer writes; the public line and block writers sit on top of these.
+		string_view::size_type write_span(ordinate_t& x, const ordinate_t y, const ordinate_t max_x, const string_view& text, const cell_style* const style);
+		void write_block(const ordinate_t start_x, const ordinate_t start_y, const ordinate_t max_x, const ordinate_t max_y, const string_view& text);
+		void fill_cells(const ordinate_t min_x, const ordinate_t min_y, const ordinate_t max_x, const ordinate_t max_y, const u8char_t* const ch, const cell_style& style);
+
+		std::optional<event> poll_input(const unsigned wait_ms);
+		void accept_input(event&& input);
+		event take_pending_event();
+		std::optional<event> wait_for_event_impl(const unsigned wait_ms);
 		std::optional<key_event> wait_for_key_event_impl(const unsigned wait_ms);
 
 	public:
+		// Waits for input. A paste comes as one paste_event, and a change of terminal size as a resize_event;
+		// wait_for_key_event instead hands a paste out as the key events that would have typed it, and returns
+		// nothing for a mouse or resize event.
+		template <class Rep, class Period>
+		std::optional<event> wait_for_event(const std::chrono::duration<Rep, Period>& wait_duration)
+		{
+			const auto wait_ms = std::chrono::duration_cast<std::chrono::milliseconds>(wait_duration).count();
+			return wait_for_event_impl(wait_ms);
+		}
 		template <class Rep, class Period>
 		std::optional<key_event> wait_for_key_event(const std::chrono::duration<Rep, Period>& wait_duration)
 		{
@@ -82,13 +228,29 @@ namespace termwrap
 			return wait_for_key_event_impl(wait_ms);
 		}
 
+		// Without waiting, reads all the input the terminal has pending and appends every event it makes to events,
+		// in order, returning the number appended. An application can apply a whole batch and draw once, reusing
+		// the vector from batch to batch. If there is nothing to hand out, a deferred frame is presented.
+		std::size_t drain_events(std::vector<event>& events);
 
-		// Callbacks.
-		/*template <class Callable>
-		void on_width_change(Callable&& callback);
+
+		// Callbacks. When the terminal changes size, each width or height callback is called with the new and the
+		// old size once the buffers have the new size, before the resize_event is handed out. An element registers
+		// for the dimension it lays itself out by, and removes its callback with the ID returned when it goes.
 		template <class Callable>
-		void on_height_change(Callable&& callback);
+		callback_id on_width_change(Callable&& callback)
+		{
+			width_callbacks.emplace_back(next_callback_id, std::forward<Callable>(callback));
+			return next_callback_id++;
+		}
 		template <class Callable>
+		callback_id on_height_change(Callable&& callback)
+		{
+			height_callbacks.emplace_back(next_callback_id, std::forward<Callable>(callback));
+			return next_callback_id++;
+		}
+		void remove_callback(const callback_id id);
+		/*template <class Callable>
 		void on_capabilities_change(Callable&& callback);
 		*/
 		
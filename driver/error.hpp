@@ -55,6 +55,29 @@ namespace termwrap
 		failed_peek_poll_event() : driver_system_error("Failed to peek or to poll an event.") { }
 	};
 
+	//
+	// Failed terminal I/O.
+	//
+
+	struct failed_write_error : public driver_system_error
+	{
+		failed_write_error() : driver_system_error("Failed to write to the terminal.") { }
+	};
+
+	//
+	// Event loop.
+	//
+
+	struct event_loop_error : public driver_system_error
+	{
+		event_loop_error() : driver_system_error("Failed to set up or to wait on an event source.") { }
+	};
+
+	struct input_thread_error : public driver_system_error
+	{
+		input_thread_error() : driver_system_error("Failed to start the input thread.") { }
+	};
+
 	// 
 	// UTF-8 conversions.
 	//
@@ -95,6 +118,11 @@ namespace termwrap
 		color_not_supported_error() : driver_draw_error("Color not supported in present mode.") { }
 	};
 
+	struct style_table_full_error : public driver_draw_error
+	{
+		style_table_full_error() : driver_draw_error("Too many distinct cell styles in use.") { }
+	};
+
 } // End of namespace termwrap.
 
 #endif // !RHC_TERMWRAP_ERROR_H.
@@ -0,0 +1,61 @@
+//
+// Termwrap
+//
+// termwrap/event.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#ifndef RHC_TERMWRAP_EVENT_H
+#define RHC_TERMWRAP_EVENT_H
+
+#include <variant>
+
+#include "key_event.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	// Text the user pasted, delivered whole rather than as one key event per code point. Line breaks are '\n' and
+	// tabs '\t'; no other control characters are included.
+	struct paste_event
+	{
+		string text;
+	};
+
+	enum class mouse_button
+	{
+		left,
+		right,
+		middle,
+		release,	// Any button released.
+		wheel_up,
+		wheel_down
+	};
+
+	// A mouse button or wheel at cell (x, y), reported only with mouse reporting on (driver::set_mouse_reporting).
+	// motion is set when the mouse moved with the button held.
+	struct mouse_event
+	{
+		mouse_button button;
+		ordinate_t x;
+		ordinate_t y;
+		bool motion;
+		bool alt;
+	};
+
+	// The terminal changed size. By the time it is handed out the driver's buffers have the new size, keeping the
+	// cells the old and new sizes share. Resizes not yet handed out are merged into one.
+	struct resize_event
+	{
+		ordinate_t width;
+		ordinate_t height;
+		ordinate_t old_width;
+		ordinate_t old_height;
+	};
+
+	using event = std::variant<key_event, paste_event, mouse_event, resize_event>;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_EVENT_H.
@@ -0,0 +1,392 @@
+//
+// Termwrap
+//
+// termwrap/event_loop.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "event_loop.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <ctime>
+#include <pthread.h>
+#include <sys/epoll.h>
+#include <sys/signalfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "error.hpp"
+
+namespace termwrap
+{
+	namespace
+	{
+		constexpr int max_ready = 32;
+
+		// A zero it_value disarms a timerfd, so the shortest delay is a nanosecond.
+		struct timespec to_timespec(const std::chrono::steady_clock::duration duration) noexcept
+		{
+			const auto ns = std::max<std::chrono::nanoseconds::rep>(std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count(), 1);
+			return { static_cast<time_t>(ns / 1000000000), static_cast<long>(ns % 1000000000) };
+		}
+
+		void set_timer(const int fd, const struct timespec& value, const struct timespec& interval)
+		{
+			const struct itimerspec spec{interval, value};
+			if (::timerfd_settime(fd, 0, &spec, nullptr) < 0)
+				throw event_loop_error();
+		}
+
+		void disarm_timer(const int fd)
+		{
+			set_timer(fd, {0, 0}, {0, 0});
+		}
+
+		// Reads a timerfd's expiry count so that it stops being readable.
+		void acknowledge_timer(const int fd) noexcept
+		{
+			std::uint64_t expiries;
+			[[maybe_unused]] const ssize_t result = ::read(fd, &expiries, sizeof(expiries));
+		}
+
+		std::uint32_t to_epoll(const unsigned interest) noexcept
+		{
+			return ((interest & io::readable) ? std::uint32_t{EPOLLIN} : 0) | ((interest & io::writable) ? std::uint32_t{EPOLLOUT} : 0);
+		}
+
+		unsigned from_epoll(const std::uint32_t ready) noexcept
+		{
+			return ((ready & EPOLLIN) ? io::readable : 0) | ((ready & EPOLLOUT) ? io::writable : 0)
+				| ((ready & (EPOLLHUP | EPOLLERR)) ? io::hangup : 0);
+		}
+	} // End of anonymous namespace.
+
+	event_loop::event_loop(driver& d)
+		: d(d)
+	{
+		sigemptyset(&watched_signals);
+		sigaddset(&watched_signals, SIGWINCH);
+		if (::pthread_sigmask(SIG_BLOCK, &watched_signals, &previous_mask) != 0)
+			throw event_loop_error();
+
+		try
+		{
+			epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+			signal_fd = ::signalfd(-1, &watched_signals, SFD_CLOEXEC | SFD_NONBLOCK);
+			frame_fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+			if (epoll_fd < 0 || signal_fd < 0 || frame_fd < 0)
+				throw event_loop_error();
+
+			signal_source.fd = signal_fd;
+			add_source(signal_source, io::readable);
+			frame_source.fd = frame_fd;
+			add_source(frame_source, io::readable);
+			input_source.fd = d.get_backend().input_fd();
+			if (input_source.fd >= 0)
+				add_source(input_source, io::readable);
+		}
+		catch (...)
+		{
+			for (const int fd : { frame_fd, signal_fd, epoll_fd })
+			{
+				if (fd >= 0)
+					::close(fd);
+			}
+			::pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+			throw;
+		}
+
+		// The size may have changed before SIGWINCH was blocked.
+		d.refresh_geometry();
+	}
+
+	event_loop::~event_loop()
+	{
+		for (const auto& timer : timer_sources)
+			::close(timer.second->fd);
+		::close(frame_fd);
+		::close(signal_fd);
+		::close(epoll_fd);
+		// Signals that arrived while blocked are discarded with the signalfd, except for any still pending, which
+		// are delivered now as they would have been.
+		::pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+	}
+
+	void event_loop::add_source(source& s, const unsigned interest)
+	{
+		struct epoll_event ev{};
+		ev.events = to_epoll(interest);
+		ev.data.ptr = &s;
+		if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, s.fd, &ev) < 0)
+			throw event_loop_error();
+	}
+
+	void event_loop::retire_source(std::unique_ptr<source>&& s)
+	{
+		::epoll_ctl(epoll_fd, EPOLL_CTL_DEL, s->fd, nullptr);
+		if (s->kind == source_kind::timer)
+			::close(s->fd);
+		retired_sources.push_back(std::move(s));
+	}
+
+	//
+	// File descriptors.
+	//
+
+	void event_loop::watch_fd(const int fd, const unsigned interest, fd_handler handler)
+	{
+		const auto existing = fd_sources.find(fd);
+		if (existing != fd_sources.end())
+		{
+			struct epoll_event ev{};
+			ev.events = to_epoll(interest);
+			ev.data.ptr = existing->second.get();
+			if (::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, fd, &ev) < 0)
+				throw event_loop_error();
+			existing->second->on_ready = std::move(handler);
+			return;
+		}
+
+		auto s = std::make_unique<source>(source{source_kind::fd, fd, std::move(handler)});
+		add_source(*s, interest);
+		fd_sources.emplace(fd, std::move(s));
+	}
+
+	void event_loop::unwatch_fd(const int fd)
+	{
+		const auto existing = fd_sources.find(fd);
+		if (existing == fd_sources.end())
+			return;
+		retire_source(std::move(existing->second));
+		fd_sources.erase(existing);
+	}
+
+	//
+	// Timers.
+	//
+
+	timer_id event_loop::add_timer(const std::chrono::steady_clock::duration delay, const std::chrono::steady_clock::duration interval, timer_handler handler)
+	{
+		const int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+		if (fd < 0)
+			throw event_loop_error();
+
+		const timer_id id = next_timer_id++;
+		auto s = std::make_unique<source>(source{source_kind::timer, fd, {}, std::move(handler), id, interval.count() > 0});
+		try
+		{
+			set_timer(fd, to_timespec(delay), s->repeats ? to_timespec(interval) : timespec{0, 0});
+			add_source(*s, io::readable);
+		}
+		catch (...)
+		{
+			::close(fd);
+			throw;
+		}
+		timer_sources.emplace(id, std::move(s));
+		return id;
+	}
+
+	void event_loop::cancel_timer(const timer_id id)
+	{
+		const auto existing = timer_sources.find(id);
+		if (existing == timer_sources.end())
+			return;
+		retire_source(std::move(existing->second));
+		timer_sources.erase(existing);
+	}
+
+	//
+	// Signals.
+	//
+
+	void event_loop::watch_signal(const int signal_number, signal_handler handler)
+	{
+		if (signal_number == SIGWINCH)
+			return;
+		signal_handlers[signal_number] = std::move(handler);
+		update_signal_mask();
+	}
+
+	void event_loop::unwatch_signal(const int signal_number)
+	{
+		if (signal_number == SIGWINCH || signal_handlers.erase(signal_number) == 0)
+			return;
+		update_signal_mask();
+	}
+
+	// Signals no longer watched are unblocked only if they were not blocked before the loop was made.
+	void event_loop::update_signal_mask()
+	{
+		sigset_t watched;
+		sigemptyset(&watched);
+		sigaddset(&watched, SIGWINCH);
+		for (const auto& handler : signal_handlers)
+			sigaddset(&watched, handler.first);
+
+		sigset_t released;
+		sigemptyset(&released);
+		for (int signal_number = 1; signal_number < NSIG; ++signal_number)
+		{
+			if (sigismember(&watched_signals, signal_number) == 1 && sigismember(&watched, signal_number) != 1
+				&& sigismember(&previous_mask, signal_number) != 1)
+				sigaddset(&released, signal_number);
+		}
+
+		if (::pthread_sigmask(SIG_BLOCK, &watched, nullptr) != 0 || ::signalfd(signal_fd, &watched, 0) < 0)
+			throw event_loop_error();
+		::pthread_sigmask(SIG_UNBLOCK, &released, nullptr);
+		watched_signals = watched;
+	}
+
+	void event_loop::read_signals()
+	{
+		bool resized = false;
+		struct signalfd_siginfo info;
+		while (::read(signal_fd, &info, sizeof(info)) == static_cast<ssize_t>(sizeof(info)))
+		{
+			const int signal_number = static_cast<int>(info.ssi_signo);
+			if (signal_number == SIGWINCH)
+			{
+				resized = true;
+				continue;
+			}
+			const auto handler = signal_handlers.find(signal_number);
+			if (handler != signal_handlers.end() && handler->second)
+				handler->second(signal_number);
+		}
+
+		// Resizes that arrive together are handled once, and the resize_event handed out with any input waiting.
+		if (resized)
+		{
+			d.refresh_geometry();
+			read_input();
+		}
+	}
+
+	//
+	// Dispatch.
+	//
+
+	void event_loop::read_input()
+	{
+		input_batch.clear();
+		d.drain_events(input_batch);
+		if (!events_handler)
+			return;
+		for (event& input : input_batch)
+			events_handler(input);
+	}
+
+	// The frame timer is armed for when the pending frame falls due, and disarmed while none is pending, so an idle
+	// loop has no timer armed at all. A frame already due is presented before the loop waits.
+	void event_loop::schedule_frame()
+	{
+		if (d.frame_pending())
+		{
+			const auto now = std::chrono::steady_clock::now();
+			const auto due = d.next_frame_time();
+			if (due > now)
+			{
+				if (!frame_armed || frame_armed_for != due)
+				{
+					set_timer(frame_fd, to_timespec(due - now), {0, 0});
+					frame_armed = true;
+					frame_armed_for = due;
+				}
+				return;
+			}
+			d.flush_now();
+		}
+
+		if (frame_armed)
+		{
+			disarm_timer(frame_fd);
+			frame_armed = false;
+		}
+	}
+
+	void event_loop::dispatch(source& s, const std::uint32_t ready)
+	{
+		switch (s.kind)
+		{
+			case source_kind::input:
+				read_input();
+				break;
+			case source_kind::signals:
+				read_signals();
+				break;
+			case source_kind::frame:
+				acknowledge_timer(frame_fd);
+				frame_armed = false;
+				if (d.frame_pending())
+					d.flush_now();
+				break;
+			case source_kind::fd:
+			{
+				// Called through a copy, as the handler may watch its fd again and so replace itself.
+				const fd_handler handler = s.on_ready;
+				if (handler)
+					handler(s.fd, from_epoll(ready));
+				break;
+			}
+			case source_kind::timer:
+			{
+				acknowledge_timer(s.fd);
+				// The handler is called through a copy, as it may cancel its own timer; a one-shot timer is
+				// forgotten first, so that it may add another.
+				const timer_handler handler = s.on_timer;
+				if (!s.repeats)
+					cancel_timer(s.id);
+				if (handler)
+					handler();
+				break;
+			}
+		}
+	}
+
+	std::size_t event_loop::run_once(const int wait_ms)
+	{
+		schedule_frame();
+
+		struct epoll_event ready[max_ready];
+		const int count = ::epoll_wait(epoll_fd, ready, max_ready, wait_ms);
+		if (count < 0)
+		{
+			if (errno == EINTR)
+				return 0;
+			throw event_loop_error();
+		}
+
+		try
+		{
+			for (int i = 0; i < count; ++i)
+			{
+				source& s = *static_cast<source*>(ready[i].data.ptr);
+				// A source removed earlier in the round is skipped.
+				bool retired = false;
+				for (const auto& r : retired_sources)
+					retired = retired || r.get() == &s;
+				if (!retired)
+					dispatch(s, ready[i].events);
+			}
+		}
+		catch (...)
+		{
+			retired_sources.clear();
+			throw;
+		}
+		retired_sources.clear();
+		return count;
+	}
+
+	void event_loop::run()
+	{
+		stopping = false;
+		while (!stopping)
+			run_once();
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,135 @@
+//
+// Termwrap
+//
+// termwrap/event_loop.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// event_loop waits on everything an application watches at once with epoll: terminal input, resizes, other file
+// descriptors, timers and signals. Each timer is a timerfd and the signals come through one signalfd, so the loop
+// sleeps in the kernel until something is ready and wakes for nothing else. A frame deferred by driver::redraw() is
+// presented by the loop when it falls due, on a timerfd armed only while a frame is pending.
+//
+// Signals the loop watches, SIGWINCH among them, are blocked in the thread that constructs it and restored when it
+// is destroyed. Other threads must block them too, or the kernel may deliver them there instead; the simplest way
+// is to construct the loop before starting any. The driver's input thread is the exception: it blocks every signal
+// itself, and is to be started before the loop is made, as the loop waits on the input fd it finds then.
+
+#ifndef RHC_TERMWRAP_EVENT_LOOP_H
+#define RHC_TERMWRAP_EVENT_LOOP_H
+
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "driver.hpp"
+#include "event.hpp"
+
+namespace termwrap
+{
+	// The readiness an fd is watched for, and reported to its handler.
+	namespace io
+	{
+		constexpr unsigned readable = 1;
+		constexpr unsigned writable = 2;
+		// Reported only: the fd hung up or failed.
+		constexpr unsigned hangup = 4;
+	}
+
+	using timer_id = std::uint64_t;
+
+	class event_loop
+	{
+	public:
+		using event_handler = std::function<void(event& )>;
+		using fd_handler = std::function<void(const int fd, const unsigned ready)>;
+		using timer_handler = std::function<void()>;
+		using signal_handler = std::function<void(const int signal_number)>;
+
+		explicit event_loop(driver& d);
+		~event_loop();
+
+		event_loop(const event_loop& ) = delete;
+		event_loop& operator=(const event_loop& ) = delete;
+
+		// Each batch of input is handed to the event handler one event at a time, in order. A resize comes as a
+		// resize_event as soon as SIGWINCH is read.
+		void on_event(event_handler handler) { events_handler = std::move(handler); }
+
+		// Watching an fd already watched replaces its readiness and handler. The fd is not closed by the loop;
+		// unwatch it before closing it.
+		void watch_fd(const int fd, const unsigned interest, fd_handler handler);
+		void unwatch_fd(const int fd);
+
+		// A timer first fires after delay, then every interval, or only once if the interval is zero. A one-shot
+		// timer is forgotten once it has fired. Cancelling a timer that is no longer known does nothing.
+		timer_id add_timer(const std::chrono::steady_clock::duration delay, const std::chrono::steady_clock::duration interval, timer_handler handler);
+		void cancel_timer(const timer_id id);
+
+		// SIGWINCH is always watched, for resizes, and cannot be given a handler here.
+		void watch_signal(const int signal_number, signal_handler handler);
+		void unwatch_signal(const int signal_number);
+
+		// run() dispatches until stop() is called, from a handler or a signal handler given here. run_once() waits
+		// up to wait_ms (forever if negative) for something to be ready, dispatches it and returns the number of
+		// sources that were.
+		void run();
+		std::size_t run_once(const int wait_ms = -1);
+		void stop() noexcept { stopping = true; }
+
+	private:
+		enum class source_kind { input, fd, timer, signals, frame };
+
+		struct source
+		{
+			source_kind kind;
+			int fd;
+			fd_handler on_ready{};
+			timer_handler on_timer{};
+			timer_id id = 0;
+			bool repeats = false;
+		};
+
+		driver& d;
+		int epoll_fd = -1;
+		int signal_fd = -1;
+		int frame_fd = -1;
+		source input_source{source_kind::input, -1};
+		source signal_source{source_kind::signals, -1};
+		source frame_source{source_kind::frame, -1};
+
+		std::unordered_map<int, std::unique_ptr<source>> fd_sources{};
+		std::unordered_map<timer_id, std::unique_ptr<source>> timer_sources{};
+		// Sources removed while a round is being dispatched are kept until it ends, as later events in the same
+		// round may still point at them.
+		std::vector<std::unique_ptr<source>> retired_sources{};
+		timer_id next_timer_id = 1;
+
+		sigset_t watched_signals{};
+		sigset_t previous_mask{};
+		std::unordered_map<int, signal_handler> signal_handlers{};
+
+		event_handler events_handler{};
+		std::vector<event> input_batch{};
+
+		std::chrono::steady_clock::time_point frame_armed_for{};
+		bool frame_armed = false;
+		bool stopping = false;
+
+		void add_source(source& s, const unsigned interest);
+		void retire_source(std::unique_ptr<source>&& s);
+		void update_signal_mask();
+		void schedule_frame();
+		void dispatch(source& s, const std::uint32_t ready);
+		void read_input();
+		void read_signals();
+	}; // End of class event_loop.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_EVENT_LOOP_H.
@@ -0,0 +1,154 @@
+//
+// Termwrap
+//
+// termwrap/fill_kernel.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "fill_kernel.hpp"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RHC_TERMWRAP_X86 1
+#endif
+
+namespace termwrap
+{
+	namespace
+	{
+		template <class T>
+		bool fill_scalar(T* const first, const std::size_t count, const T value) noexcept
+		{
+			bool changed = false;
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				if (first[i] != value)
+				{
+					first[i] = value;
+					changed = true;
+				}
+			}
+			return changed;
+		}
+
+#ifdef RHC_TERMWRAP_X86
+		// Each kernel stores only the vectors that differ from the fill, then finishes the span element by element.
+
+		__attribute__((target("sse2")))
+		bool fill32_sse2(std::uint32_t* const first, const std::size_t count, const std::uint32_t value) noexcept
+		{
+			const __m128i fill = _mm_set1_epi32(static_cast<int>(value));
+			bool changed = false;
+			std::size_t i = 0;
+			for (; i + 4 <= count; i += 4)
+			{
+				__m128i* const p = reinterpret_cast<__m128i*>(first + i);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi32(_mm_loadu_si128(p), fill)) != 0xffff)
+				{
+					_mm_storeu_si128(p, fill);
+					changed = true;
+				}
+			}
+			return fill_scalar(first + i, count - i, value) || changed;
+		}
+
+		__attribute__((target("sse2")))
+		bool fill16_sse2(std::uint16_t* const first, const std::size_t count, const std::uint16_t value) noexcept
+		{
+			const __m128i fill = _mm_set1_epi16(static_cast<short>(value));
+			bool changed = false;
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m128i* const p = reinterpret_cast<__m128i*>(first + i);
+				if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_loadu_si128(p), fill)) != 0xffff)
+				{
+					_mm_storeu_si128(p, fill);
+					changed = true;
+				}
+			}
+			return fill_scalar(first + i, count - i, value) || changed;
+		}
+
+		__attribute__((target("avx2")))
+		bool fill32_avx2(std::uint32_t* const first, const std::size_t count, const std::uint32_t value) noexcept
+		{
+			const __m256i fill = _mm256_set1_epi32(static_cast<int>(value));
+			bool changed = false;
+			std::size_t i = 0;
+			for (; i + 8 <= count; i += 8)
+			{
+				__m256i* const p = reinterpret_cast<__m256i*>(first + i);
+				if (static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi32(_mm256_loadu_si256(p), fill))) != 0xffffffff)
+				{
+					_mm256_storeu_si256(p, fill);
+					changed = true;
+				}
+			}
+			return fill_scalar(first + i, count - i, value) || changed;
+		}
+
+		__attribute__((target("avx2")))
+		bool fill16_avx2(std::uint16_t* const first, const std::size_t count, const std::uint16_t value) noexcept
+		{
+			const __m256i fill = _mm256_set1_epi16(static_cast<short>(value));
+			bool changed = false;
+			std::size_t i = 0;
+			for (; i + 16 <= count; i += 16)
+			{
+				__m256i* const p = reinterpret_cast<__m256i*>(first + i);
+				if (static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi16(_mm256_loadu_si256(p), fill))) != 0xffffffff)
+				{
+					_mm256_storeu_si256(p, fill);
+					changed = true;
+				}
+			}
+			return fill_scalar(first + i, count - i, value) || changed;
+		}
+#endif
+	} // End of anonymous namespace.
+
+	bool fill_span(std::uint32_t* const first, const std::size_t count, const std::uint32_t value, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return fill32_avx2(first, count, value);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return fill32_sse2(first, count, value);
+#endif
+			default:
+				return fill_scalar(first, count, value);
+		}
+	}
+
+	bool fill_span(std::uint16_t* const first, const std::size_t count, const std::uint16_t value, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return fill16_avx2(first, count, value);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return fill16_sse2(first, count, value);
+#endif
+			default:
+				return fill_scalar(first, count, value);
+		}
+	}
+
+	bool fill_span(std::uint32_t* const first, const std::size_t count, const std::uint32_t value) noexcept
+	{
+		return fill_span(first, count, value, active_simd_level());
+	}
+
+	bool fill_span(std::uint16_t* const first, const std::size_t count, const std::uint16_t value) noexcept
+	{
+		return fill_span(first, count, value, active_simd_level());
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,31 @@
+//
+// Termwrap
+//
+// termwrap/fill_kernel.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Fills a row span of one cell buffer plane with a single value. A vector of the span is compared with the value
+// before it is stored, so a fill that repeats what is already there writes nothing and reports no change. Vectorized
+// (SSE2, AVX2) with a scalar fallback, chosen at runtime.
+
+#ifndef RHC_TERMWRAP_FILL_KERNEL_H
+#define RHC_TERMWRAP_FILL_KERNEL_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simd.hpp"
+
+namespace termwrap
+{
+	// Sets count elements from first to value. Returns true if any of them held something else.
+	bool fill_span(std::uint32_t* const first, const std::size_t count, const std::uint32_t value) noexcept;
+	bool fill_span(std::uint32_t* const first, const std::size_t count, const std::uint32_t value, const simd_level level) noexcept;
+	bool fill_span(std::uint16_t* const first, const std::size_t count, const std::uint16_t value) noexcept;
+	bool fill_span(std::uint16_t* const first, const std::size_t count, const std::uint16_t value, const simd_level level) noexcept;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_FILL_KERNEL_H.
@@ -0,0 +1,63 @@
+//
+// Termwrap
+//
+// termwrap/frame_arena.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "frame_arena.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+namespace termwrap
+{
+	frame_arena::frame_arena(const std::size_t initial_capacity)
+	{
+		chunks.push_back(chunk{std::make_unique<std::byte[]>(initial_capacity), initial_capacity});
+	}
+
+	// Bumps through the last chunk, and starts a chunk at least twice as large when it runs out.
+	void* frame_arena::allocate(const std::size_t size, const std::size_t alignment)
+	{
+		chunk* current = &chunks.back();
+		auto address = reinterpret_cast<std::uintptr_t>(current->octets.get()) + used;
+		std::size_t padding = (alignment - address % alignment) % alignment;
+
+		if (used + padding + size > current->size)
+		{
+			const std::size_t chunk_size = std::max(current->size * 2, size + alignment);
+			chunks.push_back(chunk{std::make_unique<std::byte[]>(chunk_size), chunk_size});
+			current = &chunks.back();
+			used = 0;
+			address = reinterpret_cast<std::uintptr_t>(current->octets.get());
+			padding = (alignment - address % alignment) % alignment;
+		}
+
+		used += padding;
+		void* const block = current->octets.get() + used;
+		used += size;
+		return block;
+	}
+
+	void frame_arena::reset()
+	{
+		if (chunks.size() > 1)
+		{
+			const std::size_t total = capacity();
+			chunks.clear();
+			chunks.push_back(chunk{std::make_unique<std::byte[]>(total), total});
+		}
+		used = 0;
+	}
+
+	std::size_t frame_arena::capacity() const noexcept
+	{
+		std::size_t total = 0;
+		for (const chunk& c : chunks)
+			total += c.size;
+		return total;
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,104 @@
+//
+// Termwrap
+//
+// termwrap/frame_arena.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// frame_arena is a bump allocator for scratch memory that lives no longer than one frame. The driver owns one and
+// resets it after each flush, so text built while drawing (padding, formatted labels and the like) costs a pointer
+// bump rather than a trip to the heap. Memory is never handed back piecemeal: reset() reclaims all of it at once,
+// and after a frame that outgrew the arena the chunks are merged so that later frames of the same size allocate
+// nothing.
+//
+// Anything allocated from the arena must be destroyed before the arena is next reset, i.e. before the driver next
+// flushes a frame.
+
+#ifndef RHC_TERMWRAP_FRAME_ARENA_H
+#define RHC_TERMWRAP_FRAME_ARENA_H
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "utf8_string.hpp"
+
+namespace termwrap
+{
+	template <class T>
+	class arena_allocator;
+
+	class frame_arena
+	{
+		struct chunk
+		{
+			std::unique_ptr<std::byte[]> octets;
+			std::size_t size;
+		};
+
+		std::vector<chunk> chunks{};
+		// Octets used in the last chunk, which is the only one still being allocated from.
+		std::size_t used = 0;
+
+	public:
+		static constexpr std::size_t default_capacity = 16*1024;
+
+		explicit frame_arena(const std::size_t initial_capacity = default_capacity);
+
+		frame_arena(const frame_arena& ) = delete;
+		frame_arena& operator=(const frame_arena& ) = delete;
+
+		void* allocate(const std::size_t size, const std::size_t alignment = alignof(std::max_align_t));
+
+		// Reclaims everything allocated since the last reset.
+		void reset();
+
+		std::size_t capacity() const noexcept;
+
+		template <class T>
+		arena_allocator<T> allocator() noexcept
+		{
+			return arena_allocator<T>(*this);
+		}
+	}; // End of class frame_arena.
+
+	// A standard allocator over a frame_arena. deallocate() does nothing; the arena's reset() reclaims the memory.
+	template <class T>
+	class arena_allocator
+	{
+		frame_arena* arena;
+
+		template <class U>
+		friend class arena_allocator;
+
+	public:
+		using value_type = T;
+
+		explicit arena_allocator(frame_arena& arena) noexcept : arena(&arena) { }
+		template <class U>
+		arena_allocator(const arena_allocator<U>& other) noexcept : arena(other.arena) { }
+
+		T* allocate(const std::size_t n)
+		{
+			return static_cast<T*>(arena->allocate(n * sizeof(T), alignof(T)));
+		}
+		void deallocate(T* const, const std::size_t) noexcept { }
+
+		template <class U>
+		bool operator==(const arena_allocator<U>& other) const noexcept
+		{
+			return arena == other.arena;
+		}
+		template <class U>
+		bool operator!=(const arena_allocator<U>& other) const noexcept
+		{
+			return arena != other.arena;
+		}
+	}; // End of class arena_allocator.
+
+	using frame_string = basic_utf8_string<arena_allocator<char>>;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_FRAME_ARENA_H.
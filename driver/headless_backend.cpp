@@ -0,0 +1,328 @@
+//
+// Termwrap
+//
+// termwrap/headless_backend.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "headless_backend.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <string_view>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "error.hpp"
+#include "output_encoder.hpp"
+
+namespace termwrap
+{
+	headless_backend::headless_backend(const ordinate_t width, const ordinate_t height)
+		: screen_cells(width, height),
+		input_event_fd(::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK))
+	{ }
+
+	headless_backend::~headless_backend()
+	{
+		if (input_event_fd >= 0)
+			::close(input_event_fd);
+	}
+
+	void headless_backend::write(const char* const octets, const std::size_t count)
+	{
+		++presents;
+		take_output(octets, count);
+	}
+
+	// Frames and control sequences alike are recorded and interpreted.
+	void headless_backend::take_output(const char* const octets, const std::size_t count)
+	{
+		octets_written += count;
+		if (record_output)
+			recorded_output.append(octets, count);
+		if (emulate_screen)
+		{
+			for (std::size_t i = 0; i < count; ++i)
+				interpret(octets[i]);
+		}
+	}
+
+	std::optional<event> headless_backend::poll_event(const unsigned )
+	{
+		++polls;
+		if (scripted_events.empty())
+			return {};
+		std::optional<event> next = std::move(scripted_events.front());
+		scripted_events.pop_front();
+		if (scripted_events.empty() && input_event_fd >= 0)
+		{
+			std::uint64_t count;
+			[[maybe_unused]] const ssize_t result = ::read(input_event_fd, &count, sizeof(count));
+		}
+		if (!mouse_reporting && std::holds_alternative<mouse_event>(*next))
+			return {};
+		return next;
+	}
+
+	// The input fd is signalled only when the queue stops being empty, and drained when it empties again.
+	void headless_backend::script(event&& scripted)
+	{
+		if (scripted_events.empty() && input_event_fd >= 0)
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const ssize_t result = ::write(input_event_fd, &one, sizeof(one));
+		}
+		scripted_events.push_back(std::move(scripted));
+	}
+
+	// As in the driver, a full table is compacted to the styles on the screen.
+	style_id_t headless_backend::intern_screen_style(const cell_style& style)
+	{
+		try
+		{
+			return screen_styles.intern(style);
+		}
+		catch (const style_table_full_error& )
+		{
+			std::vector<bool> live(screen_styles.size(), false);
+			screen_cells.mark_styles(live);
+			screen_cells.remap_styles(screen_styles.compact(live));
+		}
+		return screen_styles.intern(style);
+	}
+
+	// Termbox does not know the paste brackets. With Alt reported, each arrives as Alt+'[' and plain characters.
+	void headless_backend::push_paste(const string_view& text)
+	{
+		script(key_event('[', false, true));
+		for (const char c : std::string_view("200~"))
+			script(key_event(static_cast<u8char_t>(c)));
+		for (const u8char_t cp : text)
+		{
+			if (cp == '\n')
+				script(key_event(special_key::enter));
+			else if (cp == '\t')
+				script(key_event(special_key::tab));
+			else
+				script(key_event(cp));
+		}
+		script(key_event('[', false, true));
+		for (const char c : std::string_view("201~"))
+			script(key_event(static_cast<u8char_t>(c)));
+	}
+
+	//
+	// Terminal emulation. Only what termwrap's encoder emits is understood: UTF-8 text, CR, LF, BS, cursor motion,
+	// SGR, erase in display and cursor visibility.
+	//
+
+	void headless_backend::interpret(const char octet)
+	{
+		const auto byte = static_cast<unsigned char>(octet);
+
+		switch (state)
+		{
+			case parse_state::escape:
+				state = (byte == '[') ? parse_state::csi : parse_state::ground;
+				csi_parameters.assign(1, 0);
+				csi_private = false;
+				return;
+
+			case parse_state::csi:
+				if (byte >= '0' && byte <= '9')
+					csi_parameters.back() = csi_parameters.back()*10 + (byte - '0');
+				else if (byte == ';')
+					csi_parameters.push_back(0);
+				else if (byte == '?')
+					csi_private = true;
+				else if (byte >= 0x40 && byte <= 0x7e)
+				{
+					state = parse_state::ground;
+					execute_csi(octet);
+				}
+				return;
+
+			case parse_state::ground:
+				break;
+		}
+
+		if (pending_continuations > 0 && (byte & 0xc0) == 0x80)
+		{
+			pending_code_point = (pending_code_point << 6) | (byte & 0x3f);
+			if (--pending_continuations == 0)
+				print(pending_code_point);
+			return;
+		}
+		pending_continuations = 0;
+
+		if (byte >= 0xf0)
+		{
+			pending_code_point = byte & 0x07;
+			pending_continuations = 3;
+		}
+		else if (byte >= 0xe0)
+		{
+			pending_code_point = byte & 0x0f;
+			pending_continuations = 2;
+		}
+		else if (byte >= 0xc0)
+		{
+			pending_code_point = byte & 0x1f;
+			pending_continuations = 1;
+		}
+		else if (byte == 0x1b)
+			state = parse_state::escape;
+		else if (byte == '\r')
+		{
+			cursor_x = 0;
+			wrap_pending = false;
+		}
+		else if (byte == '\n')
+			cursor_y = std::min<ordinate_t>(cursor_y + 1, height() - 1);
+		else if (byte == '\b')
+		{
+			cursor_x -= (cursor_x > 0 && !wrap_pending) ? 1 : 0;
+			wrap_pending = false;
+		}
+		else if (byte >= 0x20)
+			print(byte);
+	}
+
+	// Printing in the last column leaves the cursor there with a wrap pending, as xterm does.
+	void headless_backend::print(const u8char_t ch)
+	{
+		if (wrap_pending)
+		{
+			cursor_x = 0;
+			cursor_y = std::min<ordinate_t>(cursor_y + 1, height() - 1);
+			wrap_pending = false;
+		}
+		if (cursor_x < width() && cursor_y < height())
+			screen_cells.set(cursor_x, cursor_y, ch, intern_screen_style(cell_style(pen_fg, pen_bg)));
+
+		const ordinate_t advance = display_width(ch);
+		if (cursor_x + advance >= width())
+		{
+			cursor_x = width() - 1;
+			wrap_pending = true;
+		}
+		else
+			cursor_x += advance;
+	}
+
+	unsigned headless_backend::parameter(const std::size_t index, const unsigned default_value) const noexcept
+	{
+		return (index < csi_parameters.size() && csi_parameters[index] != 0) ? csi_parameters[index] : default_value;
+	}
+
+	void headless_backend::execute_csi(const char final)
+	{
+		if (csi_private)
+		{
+			if (parameter(0, 0) == 25)
+				cursor_shown = (final == 'h');
+			else if (parameter(0, 0) == 2004)
+				bracketed_paste = (final == 'h');
+			return;
+		}
+
+		const ordinate_t last_x = width() - 1;
+		const ordinate_t last_y = height() - 1;
+		wrap_pending = false;
+
+		switch (final)
+		{
+			case 'H':
+				cursor_y = std::min<unsigned>(parameter(0, 1) - 1, last_y);
+				cursor_x = std::min<unsigned>(parameter(1, 1) - 1, last_x);
+				break;
+			case 'A':
+				cursor_y -= std::min<unsigned>(parameter(0, 1), cursor_y);
+				break;
+			case 'B':
+				cursor_y = std::min<unsigned>(cursor_y + parameter(0, 1), last_y);
+				break;
+			case 'C':
+				cursor_x = std::min<unsigned>(cursor_x + parameter(0, 1), last_x);
+				break;
+			case 'D':
+				cursor_x -= std::min<unsigned>(parameter(0, 1), cursor_x);
+				break;
+			case 'J':
+				if (parameter(0, 0) == 2)
+					screen_cells.clear();
+				break;
+			case 'm':
+				select_graphic_rendition();
+				break;
+			default:
+				break;
+		}
+	}
+
+	void headless_backend::select_graphic_rendition()
+	{
+		// 38 and 48 take the colour from the parameters that follow: 5;n for a palette entry or 2;r;g;b for RGB.
+		const auto extended_color = [&](std::size_t& i)
+		{
+			const unsigned form = parameter(i + 1, 0);
+			if (form == 5)
+			{
+				i += 2;
+				return native_style::from_palette(static_cast<std::uint8_t>(parameter(i, 0)));
+			}
+			if (form == 2)
+			{
+				i += 4;
+				return native_style::from_rgb(static_cast<std::uint8_t>(parameter(i-2, 0)), static_cast<std::uint8_t>(parameter(i-1, 0)), static_cast<std::uint8_t>(parameter(i, 0)));
+			}
+			i += 1;
+			return native_style::default_color;
+		};
+		const auto set_color = [](native_style_t& pen, const native_style_t color)
+		{
+			pen = (pen & ~native_style::color_mask) | color;
+		};
+
+		for (std::size_t i = 0; i < csi_parameters.size(); ++i)
+		{
+			const unsigned p = csi_parameters[i];
+			if (p == 0)
+			{
+				pen_fg = native_style::default_color;
+				pen_bg = native_style::default_color;
+			}
+			else if (p == 1)
+				pen_fg |= native_style::bold;
+			else if (p == 22)
+				pen_fg &= ~native_style::bold;
+			else if (p == 4)
+				pen_fg |= native_style::underline;
+			else if (p == 24)
+				pen_fg &= ~native_style::underline;
+			else if (p == 7)
+				pen_fg |= native_style::reverse;
+			else if (p == 27)
+				pen_fg &= ~native_style::reverse;
+			else if (p >= 30 && p <= 37)
+				set_color(pen_fg, native_style::from_palette(p - 30));
+			else if (p >= 90 && p <= 97)
+				set_color(pen_fg, native_style::from_palette(p - 90 + 8));
+			else if (p == 38)
+				set_color(pen_fg, extended_color(i));
+			else if (p == 39)
+				set_color(pen_fg, native_style::default_color);
+			else if (p >= 40 && p <= 47)
+				set_color(pen_bg, native_style::from_palette(p - 40));
+			else if (p >= 100 && p <= 107)
+				set_color(pen_bg, native_style::from_palette(p - 100 + 8));
+			else if (p == 48)
+				set_color(pen_bg, extended_color(i));
+			else if (p == 49)
+				set_color(pen_bg, native_style::default_color);
+		}
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,134 @@
+//
+// Termwrap
+//
+// termwrap/headless_backend.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// headless_backend stands in for a terminal with no tty at all, for benchmarks and tests. It has a fixed size
+// (changed only by resize()), records every octet written and the number of frames presented, replays scripted
+// key and mouse events (including pastes, split into key events as termbox delivers them), and can interpret the output
+// into an in-memory screen to check what a real terminal would show. Its input fd is an eventfd that is readable while
+// scripted events are waiting, so it can be driven by an event_loop too.
+
+#ifndef RHC_TERMWRAP_HEADLESS_BACKEND_H
+#define RHC_TERMWRAP_HEADLESS_BACKEND_H
+
+#include <cstddef>
+#include <deque>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "backend.hpp"
+#include "cell_buffer.hpp"
+#include "cell_style.hpp"
+#include "event.hpp"
+#include "key_event.hpp"
+#include "style_table.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	class headless_backend : public backend
+	{
+		cell_buffer screen_cells;
+		style_table screen_styles{};
+		std::deque<event> scripted_events{};
+		int input_event_fd = -1;
+
+		std::string recorded_output{};
+		std::size_t octets_written = 0;
+		std::size_t presents = 0;
+		std::size_t polls = 0;
+		bool record_output = true;
+		bool emulate_screen = true;
+
+		// Emulated terminal state.
+		enum class parse_state { ground, escape, csi };
+		parse_state state = parse_state::ground;
+		std::vector<unsigned> csi_parameters{};
+		bool csi_private = false;
+		u8char_t pending_code_point = 0;
+		unsigned pending_continuations = 0;
+
+		native_style_t pen_fg = 0;
+		native_style_t pen_bg = 0;
+		ordinate_t cursor_x = 0;
+		ordinate_t cursor_y = 0;
+		bool wrap_pending = false;
+		bool cursor_shown = false;
+		bool bracketed_paste = false;
+		bool mouse_reporting = false;
+		color_depth depth = color_depth::truecolor;
+
+	public:
+		headless_backend(const ordinate_t width, const ordinate_t height);
+		~headless_backend();
+
+		headless_backend(const headless_backend& ) = delete;
+		headless_backend& operator=(const headless_backend& ) = delete;
+
+		ordinate_t width() const override { return screen_cells.width(); }
+		ordinate_t height() const override { return screen_cells.height(); }
+		bool clears_on_resize() const override { return false; }
+		color_depth colors() const override { return depth; }
+
+		void write(const char* const octets, const std::size_t count) override;
+		void write_control(const char* const octets, const std::size_t count) override { take_output(octets, count); }
+		std::optional<event> poll_event(const unsigned wait_ms) override;
+		void set_mouse_reporting(const bool enable) override { mouse_reporting = enable; }
+		int input_fd() const override { return input_event_fd; }
+		void refresh_size() override { }
+
+		//
+		// Scripting.
+		//
+		void push_key_event(const key_event& event) { script(event); }
+		// Dropped when it comes to be polled unless mouse reporting is on, as a terminal would not send it.
+		void push_mouse_event(const mouse_event& event) { script(event); }
+		// Pushes text as a terminal in bracketed paste mode sends a paste.
+		void push_paste(const string_view& text);
+		void resize(const ordinate_t width, const ordinate_t height) { screen_cells.resize(width, height); }
+		// The depth reported to a driver constructed afterwards.
+		void set_colors(const color_depth depth_) noexcept { depth = depth_; }
+
+		// Recording every octet and emulating the screen both cost time; benchmarks may turn them off.
+		void set_record_output(const bool record) noexcept { record_output = record; }
+		void set_emulate_screen(const bool emulate) noexcept { emulate_screen = emulate; }
+
+		//
+		// Inspection.
+		//
+		const cell_buffer& screen() const noexcept { return screen_cells; }
+		// The style of a screen cell as the terminal would show it, its colours as sent.
+		const cell_style& style_at(const ordinate_t x, const ordinate_t y) const noexcept { return screen_styles[screen_cells.style(x, y)]; }
+		const std::string& output() const noexcept { return recorded_output; }
+		void clear_output() noexcept { recorded_output.clear(); }
+		std::size_t output_size() const noexcept { return octets_written; }
+		std::size_t present_count() const noexcept { return presents; }
+		std::size_t poll_count() const noexcept { return polls; }
+		std::size_t pending_events() const noexcept { return scripted_events.size(); }
+
+		bool cursor_visible() const noexcept { return cursor_shown; }
+		bool bracketed_paste_enabled() const noexcept { return bracketed_paste; }
+		bool mouse_reporting_enabled() const noexcept { return mouse_reporting; }
+		ordinate_t get_cursor_x() const noexcept { return cursor_x; }
+		ordinate_t get_cursor_y() const noexcept { return cursor_y; }
+
+	private:
+		void script(event&& scripted);
+		void take_output(const char* const octets, const std::size_t count);
+
+		style_id_t intern_screen_style(const cell_style& style);
+		void interpret(const char octet);
+		void print(const u8char_t ch);
+		void execute_csi(const char final);
+		void select_graphic_rendition();
+		unsigned parameter(const std::size_t index, const unsigned default_value) const noexcept;
+	}; // End of class headless_backend.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_HEADLESS_BACKEND_H.
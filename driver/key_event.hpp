@@ -10,6 +10,7 @@
 #ifndef RHC_TERMWRAP_KEY_EVENT_H
 #define RHC_TERMWRAP_KEY_EVENT_H
 
+#include <cstdint>
 #include <variant>
 
 #include "types.hpp"
@@ -46,12 +47,26 @@ namespace termwrap
 		tab
 	};
 
+	// A key event packed into 32 bits, for tables and keymaps: the code point or special key in the low 21 bits and
+	// flags above it.
+	using packed_key_t = std::uint32_t;
+
+	namespace packed_key
+	{
+		constexpr packed_key_t code_mask = 0x001fffff;
+		constexpr packed_key_t special = 0x00200000;
+		constexpr packed_key_t ctrl = 0x00400000;
+		constexpr packed_key_t alt = 0x00800000;
+		// No key; the packing of no key event.
+		constexpr packed_key_t none = 0xffffffff;
+	} // End of namespace packed_key.
+
 	struct key_event
 	{
-		key_event(const u8char_t key, const bool ctrl = false, const bool alt = false)
+		constexpr key_event(const u8char_t key, const bool ctrl = false, const bool alt = false) noexcept
 			: key(key), ctrl(ctrl), alt(alt)
 		{ }
-		key_event(const special_key key, const bool ctrl = false, const bool alt = false)
+		constexpr key_event(const special_key key, const bool ctrl = false, const bool alt = false) noexcept
 			: key(key), ctrl(ctrl), alt(alt)
 		{ }
 		key_event(const key_event& ) = default;
@@ -61,6 +76,26 @@ namespace termwrap
 
 		bool ctrl;
 		bool alt;
+
+		constexpr packed_key_t pack() const noexcept
+		{
+			const packed_key_t flags = (ctrl ? packed_key::ctrl : 0) | (alt ? packed_key::alt : 0);
+			if (std::holds_alternative<special_key>(key))
+				return packed_key::special | static_cast<packed_key_t>(std::get<special_key>(key)) | flags;
+			return (std::get<u8char_t>(key) & packed_key::code_mask) | flags;
+		}
+		// The argument must not be packed_key::none.
+		static constexpr key_event unpack(const packed_key_t packed) noexcept
+		{
+			const bool ctrl = packed & packed_key::ctrl;
+			const bool alt = packed & packed_key::alt;
+			if (packed & packed_key::special)
+				return key_event(static_cast<special_key>(packed & packed_key::code_mask), ctrl, alt);
+			return key_event(static_cast<u8char_t>(packed & packed_key::code_mask), ctrl, alt);
+		}
+
+		friend constexpr bool operator==(const key_event& a, const key_event& b) noexcept { return a.pack() == b.pack(); }
+		friend constexpr bool operator!=(const key_event& a, const key_event& b) noexcept { return a.pack() != b.pack(); }
 	};
 }
 
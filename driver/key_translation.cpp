@@ -0,0 +1,139 @@
+//
+// Termwrap
+//
+// termwrap/key_translation.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "key_translation.hpp"
+
+#include <cstddef>
+#include <iterator>
+
+#include "/opt/termbox/include/termbox.h"
+
+namespace termwrap
+{
+	namespace
+	{
+		template <std::size_t N, class T>
+		struct table
+		{
+			T entries[N];
+			constexpr const T& operator[](const std::size_t i) const noexcept { return entries[i]; }
+		};
+
+		// Control codes index the table directly; the codes counting down from 0xffff follow them.
+		constexpr std::size_t control_codes = 0x80;
+		constexpr native_key_t lowest_special_key = TB_KEY_MOUSE_WHEEL_DOWN;
+		constexpr std::size_t native_keys = control_codes + (0xffff - lowest_special_key + 1);
+		constexpr std::size_t no_index = native_keys;
+
+		constexpr std::size_t key_index(const native_key_t key) noexcept
+		{
+			if (key < control_codes)
+				return key;
+			return (key >= lowest_special_key) ? control_codes + (key - lowest_special_key) : no_index;
+		}
+
+		// Each native key has two entries, without and with Alt.
+		struct key_table_builder
+		{
+			table<2*native_keys, packed_key_t> keys{};
+
+			constexpr key_table_builder()
+			{
+				for (auto& entry : keys.entries)
+					entry = packed_key::none;
+
+				add(TB_KEY_F1, key_event(special_key::F1));
+				add(TB_KEY_F2, key_event(special_key::F2));
+				add(TB_KEY_F3, key_event(special_key::F3));
+				add(TB_KEY_F4, key_event(special_key::F4));
+				add(TB_KEY_F5, key_event(special_key::F5));
+				add(TB_KEY_F6, key_event(special_key::F6));
+				add(TB_KEY_F7, key_event(special_key::F7));
+				add(TB_KEY_F8, key_event(special_key::F8));
+				add(TB_KEY_F9, key_event(special_key::F9));
+				add(TB_KEY_F10, key_event(special_key::F10));
+				add(TB_KEY_F11, key_event(special_key::F11));
+				add(TB_KEY_F12, key_event(special_key::F12));
+
+				add(TB_KEY_INSERT, key_event(special_key::insert));
+				add(TB_KEY_DELETE, key_event(special_key::del));
+				add(TB_KEY_HOME, key_event(special_key::home));
+				add(TB_KEY_END, key_event(special_key::end));
+				add(TB_KEY_PGUP, key_event(special_key::page_up));
+				add(TB_KEY_PGDN, key_event(special_key::page_down));
+
+				add(TB_KEY_ARROW_UP, key_event(special_key::arrow_up));
+				add(TB_KEY_ARROW_DOWN, key_event(special_key::arrow_down));
+				add(TB_KEY_ARROW_LEFT, key_event(special_key::arrow_left));
+				add(TB_KEY_ARROW_RIGHT, key_event(special_key::arrow_right));
+
+				// Ctrl+H, Ctrl+I, Ctrl+M and Ctrl+'3' share their codes with backspace, tab, enter and escape, which
+				// are added after them and so win. Ctrl+'2' is also Ctrl+space, and Ctrl+'8' is backspace.
+				for (native_key_t key = TB_KEY_CTRL_A; key <= TB_KEY_CTRL_Z; ++key)
+					add(key, key_event(static_cast<u8char_t>('A' + key - TB_KEY_CTRL_A), true));
+				add(TB_KEY_CTRL_2, key_event('2', true));
+				add(TB_KEY_CTRL_4, key_event('4', true));
+				add(TB_KEY_CTRL_5, key_event('5', true));
+				add(TB_KEY_CTRL_6, key_event('6', true));
+				add(TB_KEY_CTRL_7, key_event('7', true));
+
+				add(TB_KEY_ESC, key_event(special_key::escape));
+				add(TB_KEY_ENTER, key_event(special_key::enter));
+				add(TB_KEY_TAB, key_event(special_key::tab));
+				add(TB_KEY_BACKSPACE, key_event(special_key::backspace));
+				add(TB_KEY_BACKSPACE2, key_event(special_key::backspace));
+				add(TB_KEY_SPACE, key_event(' '));
+			}
+
+			constexpr void add(const native_key_t key, const key_event& event)
+			{
+				const std::size_t index = key_index(key);
+				keys.entries[2*index] = event.pack();
+				keys.entries[2*index + 1] = event.pack() | packed_key::alt;
+			}
+		};
+
+		constexpr auto key_table = key_table_builder().keys;
+
+		static_assert(key_table[2*key_index(TB_KEY_CTRL_H)] == key_event(special_key::backspace).pack());
+		static_assert(key_table[2*key_index(TB_KEY_CTRL_J) + 1] == key_event('J', true, true).pack());
+		static_assert(key_table[2*key_index(TB_KEY_MOUSE_LEFT)] == packed_key::none);
+
+		constexpr mouse_button mouse_buttons[] = {
+			mouse_button::wheel_down,	// TB_KEY_MOUSE_WHEEL_DOWN
+			mouse_button::wheel_up,		// TB_KEY_MOUSE_WHEEL_UP
+			mouse_button::release,		// TB_KEY_MOUSE_RELEASE
+			mouse_button::middle,		// TB_KEY_MOUSE_MIDDLE
+			mouse_button::right,		// TB_KEY_MOUSE_RIGHT
+			mouse_button::left			// TB_KEY_MOUSE_LEFT
+		};
+		static_assert(TB_KEY_MOUSE_LEFT - TB_KEY_MOUSE_WHEEL_DOWN + 1 == std::size(mouse_buttons));
+	} // End of anonymous namespace.
+
+	std::optional<key_event> translate_key(const native_key_t key, const u8char_t ch, const bool alt) noexcept
+	{
+		if (ch != 0)
+			return key_event(ch, false, alt);
+
+		const std::size_t index = key_index(key);
+		if (index == no_index)
+			return {};
+		const packed_key_t packed = key_table[2*index + alt];
+		if (packed == packed_key::none)
+			return {};
+		return key_event::unpack(packed);
+	}
+
+	std::optional<mouse_button> translate_mouse_button(const native_key_t key) noexcept
+	{
+		if (key < TB_KEY_MOUSE_WHEEL_DOWN || key > TB_KEY_MOUSE_LEFT)
+			return {};
+		return mouse_buttons[key - TB_KEY_MOUSE_WHEEL_DOWN];
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,37 @@
+//
+// Termwrap
+//
+// termwrap/key_translation.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Translation of termbox's native input codes to termwrap events. Termbox reports a key either as a code point or
+// as a native key code: a control code (0x00 to 0x20, or 0x7f), or one of the codes counting down from 0xffff for
+// the function, editing, arrow and mouse keys. Native codes are looked up in a dense table built at compile time and
+// indexed by the code and the Alt modifier, so a key is translated with one load.
+
+#ifndef RHC_TERMWRAP_KEY_TRANSLATION_H
+#define RHC_TERMWRAP_KEY_TRANSLATION_H
+
+#include <cstdint>
+#include <optional>
+
+#include "event.hpp"
+#include "key_event.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	using native_key_t = std::uint16_t;
+
+	// The key event for a termbox key: the code point ch if it is not 0, otherwise the native key code. Returns
+	// nothing for a code termbox does not define or that is not a key.
+	std::optional<key_event> translate_key(const native_key_t key, const u8char_t ch, const bool alt) noexcept;
+
+	// The button of a termbox mouse key code, or nothing if it is not one.
+	std::optional<mouse_button> translate_mouse_button(const native_key_t key) noexcept;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_KEY_TRANSLATION_H.
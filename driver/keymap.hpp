@@ -0,0 +1,43 @@
+//
+// Termwrap
+//
+// termwrap/keymap.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// keymap rebinds keys before the driver hands them out: each bound key event is replaced by the one it is bound to.
+// A binding matches the key and its modifiers exactly. Keys are held packed, so looking one up hashes an integer, and
+// an empty keymap costs one test per key event.
+
+#ifndef RHC_TERMWRAP_KEYMAP_H
+#define RHC_TERMWRAP_KEYMAP_H
+
+#include <unordered_map>
+
+#include "key_event.hpp"
+
+namespace termwrap
+{
+	class keymap
+	{
+		std::unordered_map<packed_key_t, packed_key_t> bindings{};
+
+	public:
+		void bind(const key_event& from, const key_event& to) { bindings[from.pack()] = to.pack(); }
+		void unbind(const key_event& from) { bindings.erase(from.pack()); }
+		void clear() noexcept { bindings.clear(); }
+		bool empty() const noexcept { return bindings.empty(); }
+
+		key_event translate(const key_event& key) const
+		{
+			if (bindings.empty())
+				return key;
+			const auto binding = bindings.find(key.pack());
+			return (binding == bindings.end()) ? key : key_event::unpack(binding->second);
+		}
+	}; // End of class keymap.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_KEYMAP_H.
@@ -0,0 +1,398 @@
+//
+// Termwrap
+//
+// termwrap/output_encoder.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "output_encoder.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <charconv>
+#include <cstddef>
+#include <iterator>
+#include <wchar.h>
+
+#include "/opt/utf8/source/utf8.h"
+
+namespace termwrap
+{
+	namespace
+	{
+		// The longest sequences the encoder builds: an SGR that turns every attribute off and sets both colours as
+		// RGB, and a relative move of the longest CUU or CUD, a carriage return and the longest CUB or CUF, which is
+		// built in full before it is compared with the absolute move.
+		constexpr std::size_t max_sgr = sizeof("\x1b[22;24;27;38;2;255;255;255;48;2;255;255;255m") - 1;
+		constexpr std::size_t max_move = 2 * (sizeof("\x1b[65535B") - 1) + 1;
+
+		// A short escape sequence built on the stack, so that candidate encodings can be compared without
+		// allocating. Writes past the end are dropped, which the bounds above ensure never happens.
+		struct sequence
+		{
+			static constexpr std::size_t capacity = 64;
+			char octets[capacity];
+			std::size_t length = 0;
+
+			void append(const char c) noexcept
+			{
+				assert(length < capacity);
+				if (length < capacity)
+					octets[length++] = c;
+			}
+			void append(const char* s) noexcept
+			{
+				while (*s)
+					append(*s++);
+			}
+			void append(const sequence& other) noexcept
+			{
+				for (std::size_t i = 0; i < other.length; ++i)
+					append(other.octets[i]);
+			}
+			void append_number(const unsigned n) noexcept
+			{
+				length = std::to_chars(octets + length, octets + capacity, n).ptr - octets;
+			}
+			// CSI n final, leaving out n when it is the default of 1.
+			void append_csi(const unsigned n, const char final) noexcept
+			{
+				append("\x1b[");
+				if (n != 1)
+					append_number(n);
+				append(final);
+			}
+			void repeat(const char c, unsigned n) noexcept
+			{
+				for (; n > 0; --n)
+					append(c);
+			}
+		};
+		static_assert(max_sgr <= sequence::capacity && max_move <= sequence::capacity);
+
+		// SGR parameters, separated by semicolons.
+		struct sgr_parameters
+		{
+			sequence& out;
+			bool first = true;
+
+			void add(const unsigned parameter) noexcept
+			{
+				if (!first)
+					out.append(';');
+				out.append_number(parameter);
+				first = false;
+			}
+		};
+
+		// Selects a colour with base 30 for the foreground or 40 for the background: base+9 for the default, base+n
+		// for the eight ANSI colours, base+60+n for their bright forms, base+8;5;n for the rest of the palette and
+		// base+8;2;r;g;b for RGB.
+		void add_color(sgr_parameters& parameters, const native_style_t native, const unsigned base) noexcept
+		{
+			const color_value c = color_value::from_native(native);
+			if (c.is_default())
+				parameters.add(base + 9);
+			else if (c.is_palette() && c.palette_index() < 8)
+				parameters.add(base + c.palette_index());
+			else if (c.is_palette() && c.palette_index() < 16)
+				parameters.add(base + 60 + c.palette_index() - 8);
+			else if (c.is_palette())
+			{
+				parameters.add(base + 8);
+				parameters.add(5);
+				parameters.add(c.palette_index());
+			}
+			else
+			{
+				parameters.add(base + 8);
+				parameters.add(2);
+				parameters.add(c.red());
+				parameters.add(c.green());
+				parameters.add(c.blue());
+			}
+		}
+
+		struct attribute_code
+		{
+			native_style_t mask;
+			unsigned on;
+			unsigned off;
+		};
+
+		constexpr attribute_code attribute_codes[] = {
+			{ native_style::bold, 1, 22 },
+			{ native_style::underline, 4, 24 },
+			{ native_style::reverse, 7, 27 }
+		};
+
+		// The whole style after a reset.
+		sequence full_sgr(const native_style_t fg, const native_style_t bg) noexcept
+		{
+			sequence full;
+			full.append("\x1b[");
+			{
+				sgr_parameters parameters{full};
+				parameters.add(0);
+				for (const auto& attribute : attribute_codes)
+				{
+					if (fg & attribute.mask)
+						parameters.add(attribute.on);
+				}
+				if ((fg & native_style::color_mask) != native_style::default_color)
+					add_color(parameters, fg, 30);
+				if ((bg & native_style::color_mask) != native_style::default_color)
+					add_color(parameters, bg, 40);
+			}
+			full.append('m');
+			return full;
+		}
+
+		// Only what changes from one style to another.
+		sequence delta_sgr(const native_style_t from_fg, const native_style_t from_bg, const native_style_t fg, const native_style_t bg) noexcept
+		{
+			sequence delta;
+			delta.append("\x1b[");
+			{
+				sgr_parameters parameters{delta};
+				for (const auto& attribute : attribute_codes)
+				{
+					if ((fg & attribute.mask) != (from_fg & attribute.mask))
+						parameters.add((fg & attribute.mask) ? attribute.on : attribute.off);
+				}
+				if ((fg & native_style::color_mask) != (from_fg & native_style::color_mask))
+					add_color(parameters, fg, 30);
+				if ((bg & native_style::color_mask) != (from_bg & native_style::color_mask))
+					add_color(parameters, bg, 40);
+			}
+			delta.append('m');
+			return delta;
+		}
+
+		bool is_plain_ascii(const u8char_t ch) noexcept
+		{
+			return ch >= 0x20 && ch < 0x7f;
+		}
+	} // End of anonymous namespace.
+
+	ordinate_t display_width(const u8char_t ch) noexcept
+	{
+		if (ch < 0x80)
+			return 1;
+		const int width = ::wcwidth(static_cast<wchar_t>(ch));
+		return (width < 1) ? 1 : width;
+	}
+
+	// The cached sequences were built for the old depth.
+	void output_encoder::set_color_depth(const color_depth depth_) noexcept
+	{
+		depth = depth_;
+		forget_styles();
+	}
+
+	// The pen is forgotten too, as its ID may now name another style.
+	void output_encoder::forget_styles() noexcept
+	{
+		pen_known = false;
+		pens.clear();
+		pen_sequences.clear();
+		for (auto& transition : transitions)
+			transition.key = no_transition;
+	}
+
+	void output_encoder::write_run(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const cell_run& run, const style_table& styles)
+	{
+		const u8char_t* const code_points = back.code_point_row(y);
+		const style_id_t* const style_ids = back.style_row(y);
+
+		for (ordinate_t x = run.begin; x < run.end; )
+		{
+			move_to(x, y, front);
+			set_pen(style_ids[x], styles);
+			const ordinate_t width = display_width(code_points[x]);
+			put(code_points[x], width);
+
+			// The terminal may or may not have wrapped after the last column, so the position is no longer known.
+			if (cursor_x >= back.width())
+				cursor_known = false;
+			x += width;
+		}
+	}
+
+	void output_encoder::place_cursor(const bool visible, const ordinate_t x, const ordinate_t y, const cell_buffer& front)
+	{
+		if (visible)
+		{
+			move_to(x, y, front);
+			if (!cursor_shown)
+				buffer.append("\x1b[?25h");
+		}
+		else if (cursor_shown)
+			buffer.append("\x1b[?25l");
+		cursor_shown = visible;
+	}
+
+	// Chooses the shortest of an absolute move; a vertical move (LF or CUU/CUD) followed by a horizontal one; or the
+	// same after a carriage return. Horizontal moves are BS or CUB to the left, and CUF or overwriting the cells in
+	// between to the right, which is possible when they are plain ASCII already drawn in the current pen.
+	void output_encoder::move_to(const ordinate_t x, const ordinate_t y, const cell_buffer& front)
+	{
+		if (cursor_known && x == cursor_x && y == cursor_y)
+			return;
+
+		sequence best;
+		best.append("\x1b[");
+		if (x != 0 || y != 0)
+			best.append_number(y + 1u);
+		if (x != 0)
+		{
+			best.append(';');
+			best.append_number(x + 1u);
+		}
+		best.append('H');
+
+		if (cursor_known)
+		{
+			sequence vertical;
+			if (y > cursor_y)
+			{
+				const unsigned n = y - cursor_y;
+				sequence csi;
+				csi.append_csi(n, 'B');
+				if (n <= csi.length)
+					vertical.repeat('\n', n);
+				else
+					vertical.append(csi);
+			}
+			else if (y < cursor_y)
+				vertical.append_csi(cursor_y - y, 'A');
+
+			const auto horizontal = [&](sequence& s, const ordinate_t from)
+			{
+				if (x < from)
+				{
+					const unsigned n = from - x;
+					sequence csi;
+					csi.append_csi(n, 'D');
+					if (n <= csi.length)
+						s.repeat('\b', n);
+					else
+						s.append(csi);
+				}
+				else if (x > from)
+				{
+					const unsigned n = x - from;
+					sequence csi;
+					csi.append_csi(n, 'C');
+
+					bool overwrite = pen_known && n < csi.length;
+					for (ordinate_t i = from; overwrite && i < x; ++i)
+						overwrite = is_plain_ascii(front.code_point(i, y)) && front.style(i, y) == pen_id;
+
+					if (overwrite)
+					{
+						for (ordinate_t i = from; i < x; ++i)
+							s.append(static_cast<char>(front.code_point(i, y)));
+					}
+					else
+						s.append(csi);
+				}
+			};
+
+			sequence relative = vertical;
+			horizontal(relative, cursor_x);
+			if (relative.length < best.length)
+				best = relative;
+
+			if (x < cursor_x)
+			{
+				sequence from_margin = vertical;
+				from_margin.append('\r');
+				horizontal(from_margin, 0);
+				if (from_margin.length < best.length)
+					best = from_margin;
+			}
+		}
+
+		buffer.append(best.octets, best.length);
+		cursor_x = x;
+		cursor_y = y;
+		cursor_known = true;
+	}
+
+	// Builds the entry for a style the first time it is drawn. Colours are reduced to the terminal's depth here, so
+	// styles that look the same on this terminal need no change between them.
+	const output_encoder::pen_entry& output_encoder::pen_for(const style_id_t id, const style_table& styles)
+	{
+		if (id >= pens.size())
+			pens.resize(styles.size());
+		pen_entry& pen = pens[id];
+		if (!pen.valid)
+		{
+			const cell_style& style = styles[id];
+			pen.fg = native_style::reduce(style.to_native_fg(), depth);
+			pen.bg = native_style::reduce(style.to_native_bg(), depth);
+			const sequence full = full_sgr(pen.fg, pen.bg);
+			pen.offset = static_cast<std::uint32_t>(pen_sequences.size());
+			pen.length = static_cast<std::uint8_t>(full.length);
+			pen_sequences.append(full.octets, full.length);
+			pen.valid = true;
+		}
+		return pen;
+	}
+
+	// Emits whichever is shorter: the changes from the current pen, or a reset followed by the whole style. Both
+	// depend only on the two style IDs, so the choice is remembered in the transition cache.
+	void output_encoder::set_pen(const style_id_t id, const style_table& styles)
+	{
+		if (pen_known && id == pen_id)
+			return;
+
+		const pen_entry to = pen_for(id, styles);
+		if (!pen_known)
+			buffer.append(pen_sequences, to.offset, to.length);
+		else
+		{
+			const std::uint32_t key = (std::uint32_t{pen_id} << 16) | id;
+			static_assert(max_sgr <= max_sgr_length);
+			// The top eight bits of a Fibonacci hash of the pair pick one of the 256 slots.
+			static_assert(transition_slots == 256);
+			transition_entry& transition = transitions[(key * 0x9e3779b1u) >> 24];
+			if (transition.key != key)
+			{
+				const pen_entry& from = pens[pen_id];
+				sequence chosen;
+				if (to.fg != from.fg || to.bg != from.bg)
+				{
+					chosen = delta_sgr(from.fg, from.bg, to.fg, to.bg);
+					if (to.length <= chosen.length)
+					{
+						std::copy_n(pen_sequences.data() + to.offset, to.length, chosen.octets);
+						chosen.length = to.length;
+					}
+				}
+				transition.key = key;
+				transition.length = static_cast<std::uint8_t>(chosen.length);
+				std::copy_n(chosen.octets, chosen.length, transition.octets);
+			}
+			buffer.append(transition.octets, transition.length);
+		}
+
+		pen_id = id;
+		pen_known = true;
+	}
+
+	// Control characters would move the cursor behind the encoder's back, so they are drawn as spaces.
+	void output_encoder::put(const u8char_t ch, const ordinate_t width)
+	{
+		if (ch < 0x20 || ch == 0x7f)
+			buffer.push_back(' ');
+		else if (ch < 0x80)
+			buffer.push_back(static_cast<char>(ch));
+		else
+			utf8::unchecked::append(ch, std::back_inserter(buffer));
+		cursor_x += width;
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,115 @@
+//
+// Termwrap
+//
+// termwrap/output_encoder.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// output_encoder turns runs of changed cells into ANSI/VT100 escape sequences. It remembers the terminal's cursor
+// position and pen (the current SGR state) so that each cursor motion is the cheapest of CUP, relative moves,
+// CR/LF/BS and overwriting cells already on the screen, and each style change is emitted as a delta from the pen.
+// Cells name their styles by ID (see style_table.hpp), so the SGR sequence for a style is built once, the first time it
+// is drawn, and a change of pen between two styles is looked up rather than rebuilt. Everything for a frame accumulates
+// in one reusable buffer so the driver can hand it to the terminal in a single write(2).
+
+#ifndef RHC_TERMWRAP_OUTPUT_ENCODER_H
+#define RHC_TERMWRAP_OUTPUT_ENCODER_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "cell_buffer.hpp"
+#include "cell_style.hpp"
+#include "diff_kernel.hpp"
+#include "style_table.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	// Number of columns the terminal advances for a code point; unprintable ones count as one.
+	ordinate_t display_width(const u8char_t ch) noexcept;
+
+	class output_encoder
+	{
+		std::string buffer{};
+
+		// Terminal state as of the end of the buffer. The pen is kept as the ID of the style it was last set for.
+		style_id_t pen_id = style_table::default_id;
+		bool pen_known = false;
+		color_depth depth = color_depth::truecolor;
+
+		// Longer than any SGR sequence set_pen emits.
+		static constexpr std::size_t max_sgr_length = 48;
+
+		// For each style ID drawn so far, its colours reduced to the terminal's depth and the SGR sequence that
+		// sets it after a reset, held in pen_sequences.
+		struct pen_entry
+		{
+			native_style_t fg = 0;
+			native_style_t bg = 0;
+			std::uint32_t offset = 0;
+			std::uint8_t length = 0;
+			bool valid = false;
+		};
+		std::vector<pen_entry> pens{};
+		std::string pen_sequences{};
+
+		// The sequence chosen for each recent change of pen, keyed by the pair of style IDs. Direct-mapped: a pair
+		// that collides with another simply replaces it.
+		struct transition_entry
+		{
+			std::uint32_t key = no_transition;
+			std::uint8_t length = 0;
+			char octets[max_sgr_length];
+		};
+		static constexpr std::uint32_t no_transition = 0xffffffff;
+		static constexpr std::size_t transition_slots = 256;
+		std::array<transition_entry, transition_slots> transitions{};
+
+		ordinate_t cursor_x = 0;
+		ordinate_t cursor_y = 0;
+		bool cursor_known = false;
+		bool cursor_shown = false;
+
+	public:
+		// Forgets the cursor position and pen, for when something else has written to the terminal.
+		void reset() noexcept
+		{
+			pen_known = false;
+			cursor_known = false;
+		}
+
+		// Drops the pens and transitions cached by style ID, for when the IDs have been renumbered.
+		void forget_styles() noexcept;
+
+		// Colours the terminal cannot show are sent as the nearest it can.
+		void set_color_depth(const color_depth depth_) noexcept;
+		color_depth get_color_depth() const noexcept { return depth; }
+
+		// Encodes a run of cells of row y from the back buffer. The front buffer must still hold what is on the
+		// screen, since cells beside the run may be overwritten as the cheapest way to move the cursor. Style IDs
+		// are looked up in styles, which must be the same table on every call.
+		void write_run(const cell_buffer& back, const cell_buffer& front, const ordinate_t y, const cell_run& run, const style_table& styles);
+
+		// Leaves the terminal cursor shown at (x, y), or hidden.
+		void place_cursor(const bool visible, const ordinate_t x, const ordinate_t y, const cell_buffer& front);
+
+		const char* data() const noexcept { return buffer.data(); }
+		std::size_t size() const noexcept { return buffer.size(); }
+		bool empty() const noexcept { return buffer.empty(); }
+		void clear() noexcept { buffer.clear(); }
+
+	private:
+		void move_to(const ordinate_t x, const ordinate_t y, const cell_buffer& front);
+		void set_pen(const style_id_t id, const style_table& styles);
+		const pen_entry& pen_for(const style_id_t id, const style_table& styles);
+		void put(const u8char_t ch, const ordinate_t width);
+	}; // End of class output_encoder.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_OUTPUT_ENCODER_H.
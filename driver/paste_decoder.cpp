@@ -0,0 +1,134 @@
+//
+// Termwrap
+//
+// termwrap/paste_decoder.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "paste_decoder.hpp"
+
+#include <utility>
+
+namespace termwrap
+{
+	namespace
+	{
+		constexpr char start_sequence[] = "\x1b[200~";
+		constexpr char end_sequence[] = "\x1b[201~";
+		constexpr std::size_t sequence_length = 6;
+
+		// The octet a key event stands for in an escape sequence, or 0 if it cannot be part of one.
+		char sequence_octet(const key_event& key) noexcept
+		{
+			if (key.ctrl || key.alt)
+				return 0;
+			if (const auto special = std::get_if<special_key>(&key.key))
+				return (*special == special_key::escape) ? '\x1b' : 0;
+			const u8char_t cp = std::get<u8char_t>(key.key);
+			return (cp < 0x80) ? static_cast<char>(cp) : 0;
+		}
+
+		// The number of octets of sequence, from octet matched on, that a key event stands for: Alt+'[' is an
+		// escape and '[', and may start a sequence.
+		std::size_t match(const key_event& key, const char* const sequence, const std::size_t matched) noexcept
+		{
+			if (matched == 0 && key == key_event('[', false, true))
+				return 2;
+			return (sequence_octet(key) == sequence[matched]) ? 1 : 0;
+		}
+
+		// Appends the text that a key event stands for within a paste. Termbox reports CR as the enter key and LF
+		// as Ctrl+J; both become '\n'.
+		void append_text(const key_event& key, string& text)
+		{
+			if (const auto special = std::get_if<special_key>(&key.key))
+			{
+				if (*special == special_key::enter)
+					text.push_back('\n');
+				else if (*special == special_key::tab)
+					text.push_back('\t');
+				return;
+			}
+
+			const u8char_t cp = std::get<u8char_t>(key.key);
+			if (!key.ctrl)
+				text.push_back(cp);
+			else if (cp == 'J' || cp == 'M')
+				text.push_back('\n');
+		}
+	} // End of anonymous namespace.
+
+	void paste_decoder::feed(const key_event& key, std::deque<event>& ready)
+	{
+		if (state == decoder_state::ground)
+			feed_ground(key, ready);
+		else
+			feed_paste(key, ready);
+	}
+
+	void paste_decoder::flush(std::deque<event>& ready)
+	{
+		for (const key_event& key : held)
+			ready.push_back(key);
+		held.clear();
+		matched = 0;
+	}
+
+	void paste_decoder::feed_ground(const key_event& key, std::deque<event>& ready)
+	{
+		if (const std::size_t length = match(key, start_sequence, matched))
+		{
+			held.push_back(key);
+			matched += length;
+			if (matched == sequence_length)
+			{
+				held.clear();
+				matched = 0;
+				text.clear();
+				state = decoder_state::paste;
+			}
+			return;
+		}
+
+		// Not a paste after all. The key that broke the match may yet start one.
+		flush(ready);
+		if (const std::size_t length = match(key, start_sequence, 0))
+		{
+			held.push_back(key);
+			matched = length;
+			return;
+		}
+		ready.push_back(key);
+	}
+
+	void paste_decoder::feed_paste(const key_event& key, std::deque<event>& ready)
+	{
+		if (const std::size_t length = match(key, end_sequence, matched))
+		{
+			matched += length;
+			if (matched == sequence_length)
+			{
+				ready.push_back(paste_event{std::move(text)});
+				text.clear();
+				matched = 0;
+				state = decoder_state::ground;
+			}
+			return;
+		}
+
+		// A partial end sequence was pasted text after all. Its escape is a control character and is dropped.
+		if (matched > 0)
+		{
+			text.append(end_sequence + 1, end_sequence + matched);
+			matched = 0;
+			if (const std::size_t length = match(key, end_sequence, 0))
+			{
+				matched = length;
+				return;
+			}
+		}
+		append_text(key, text);
+	}
+} // End of namespace termwrap.
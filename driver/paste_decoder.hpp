@@ -0,0 +1,62 @@
+//
+// Termwrap
+//
+// termwrap/paste_decoder.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// paste_decoder picks bracketed pastes out of a stream of key events. With bracketed paste mode on (CSI ?2004h) the
+// terminal sends a paste as CSI 200~, the text, and CSI 201~. Termbox does not know these sequences, so they reach
+// termwrap as Alt+'[' (or, with Alt not reported, an escape key and '[') followed by the characters '2', '0', '0' and
+// '~', and the text as one key event per code point. The decoder holds back key events that might be the start of a
+// paste, collects the text of a paste and hands it on as one paste_event; anything else passes straight through.
+
+#ifndef RHC_TERMWRAP_PASTE_DECODER_H
+#define RHC_TERMWRAP_PASTE_DECODER_H
+
+#include <cstddef>
+#include <deque>
+#include <vector>
+
+#include "event.hpp"
+#include "key_event.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	class paste_decoder
+	{
+		enum class decoder_state
+		{
+			ground,	// Passing key events through, or holding back what may be the start of a paste.
+			paste	// Collecting the text of a paste.
+		};
+
+		decoder_state state = decoder_state::ground;
+		// Octets of the start or end sequence matched so far.
+		std::size_t matched = 0;
+		// In the ground state, the key events that matched the start sequence so far.
+		std::vector<key_event> held{};
+		string text{};
+
+	public:
+		// Takes one key event, appending to ready the events that it completes.
+		void feed(const key_event& key, std::deque<event>& ready);
+
+		// Gives up on a partly matched start sequence, for when no more input came to finish it, and releases the
+		// key events held back.
+		void flush(std::deque<event>& ready);
+
+		// True if key events are being held back because they may be the start of a paste.
+		bool holding() const noexcept { return !held.empty(); }
+		bool in_paste() const noexcept { return state == decoder_state::paste; }
+
+	private:
+		void feed_ground(const key_event& key, std::deque<event>& ready);
+		void feed_paste(const key_event& key, std::deque<event>& ready);
+	}; // End of class paste_decoder.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_PASTE_DECODER_H.
@@ -0,0 +1,64 @@
+//
+// Termwrap
+//
+// termwrap/simd.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Runtime detection of the vector instruction sets that termwrap's kernels are built for. Kernels are compiled with
+// per-function target attributes, so the library itself needs no special flags and still runs on any x86-64.
+
+#ifndef RHC_TERMWRAP_SIMD_H
+#define RHC_TERMWRAP_SIMD_H
+
+namespace termwrap
+{
+	enum class simd_level
+	{
+		scalar,
+		sse2,
+		sse42,
+		avx2
+	};
+
+	inline simd_level detect_simd_level() noexcept
+	{
+#if defined(__x86_64__) || defined(__i386__)
+		__builtin_cpu_init();
+		if (__builtin_cpu_supports("avx2"))
+			return simd_level::avx2;
+		if (__builtin_cpu_supports("sse4.2"))
+			return simd_level::sse42;
+		if (__builtin_cpu_supports("sse2"))
+			return simd_level::sse2;
+#endif
+		return simd_level::scalar;
+	}
+
+	// The level detected on first use; kernels dispatch on this unless asked for a specific level.
+	inline simd_level active_simd_level() noexcept
+	{
+		static const simd_level level = detect_simd_level();
+		return level;
+	}
+
+	constexpr const char* to_string(const simd_level level) noexcept
+	{
+		switch (level)
+		{
+			case simd_level::scalar:
+				return "scalar";
+			case simd_level::sse2:
+				return "sse2";
+			case simd_level::sse42:
+				return "sse4.2";
+			case simd_level::avx2:
+				return "avx2";
+		}
+		__builtin_unreachable();
+	}
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_SIMD_H.
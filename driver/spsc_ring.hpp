@@ -0,0 +1,98 @@
+//
+// Termwrap
+//
+// termwrap/spsc_ring.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// spsc_ring is a bounded, lock-free queue between exactly one producer thread and one consumer thread. Each side
+// owns one index and publishes it with a release store; the other side's index is read with an acquire load only
+// when a cached copy says the ring looks full or empty. The indices sit on separate cache lines so that the two
+// threads do not contend for one.
+
+#ifndef RHC_TERMWRAP_SPSC_RING_H
+#define RHC_TERMWRAP_SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <new>
+#include <optional>
+#include <type_traits>
+#include <utility>
+
+namespace termwrap
+{
+	template <class T, std::size_t Capacity>
+	class spsc_ring
+	{
+		static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "The capacity must be a power of two.");
+		static constexpr std::size_t cache_line = 64;
+		static constexpr std::size_t mask = Capacity - 1;
+
+		// Consumer side: the next slot to pop, and the producer's tail as last seen.
+		alignas(cache_line) std::atomic<std::size_t> head{0};
+		std::size_t cached_tail = 0;
+		// Producer side: the next slot to push, and the consumer's head as last seen.
+		alignas(cache_line) std::atomic<std::size_t> tail{0};
+		std::size_t cached_head = 0;
+
+		alignas(cache_line) std::aligned_storage_t<sizeof(T), alignof(T)> slots[Capacity];
+
+		T* slot(const std::size_t index) noexcept { return std::launder(reinterpret_cast<T*>(&slots[index & mask])); }
+
+	public:
+		spsc_ring() = default;
+		~spsc_ring()
+		{
+			while (try_pop())
+				;
+		}
+
+		spsc_ring(const spsc_ring& ) = delete;
+		spsc_ring& operator=(const spsc_ring& ) = delete;
+
+		static constexpr std::size_t capacity() noexcept { return Capacity; }
+
+		// Producer only. Returns false, leaving value alone, if the ring is full.
+		bool try_push(T&& value) noexcept(std::is_nothrow_move_constructible_v<T>)
+		{
+			const std::size_t t = tail.load(std::memory_order_relaxed);
+			if (t - cached_head == Capacity)
+			{
+				cached_head = head.load(std::memory_order_acquire);
+				if (t - cached_head == Capacity)
+					return false;
+			}
+			::new (static_cast<void*>(&slots[t & mask])) T(std::move(value));
+			tail.store(t + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer only.
+		std::optional<T> try_pop() noexcept(std::is_nothrow_move_constructible_v<T>)
+		{
+			const std::size_t h = head.load(std::memory_order_relaxed);
+			if (h == cached_tail)
+			{
+				cached_tail = tail.load(std::memory_order_acquire);
+				if (h == cached_tail)
+					return {};
+			}
+			T* const value = slot(h);
+			std::optional<T> popped(std::move(*value));
+			value->~T();
+			head.store(h + 1, std::memory_order_release);
+			return popped;
+		}
+
+		// Consumer only; from the producer it is only a hint.
+		bool empty() const noexcept
+		{
+			return head.load(std::memory_order_relaxed) == tail.load(std::memory_order_acquire);
+		}
+	}; // End of class spsc_ring.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_SPSC_RING_H.
@@ -0,0 +1,89 @@
+//
+// Termwrap
+//
+// termwrap/style_table.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "style_table.hpp"
+
+#include "error.hpp"
+
+namespace termwrap
+{
+	namespace
+	{
+		constexpr std::size_t initial_slots = 64;
+	} // End of anonymous namespace.
+
+	style_table::style_table()
+		: slots(initial_slots, empty_slot)
+	{
+		slots[slot_of(styles[default_id])] = default_id;
+	}
+
+	// The table is kept at most half full, so probes are short and always end at an empty slot.
+	style_id_t style_table::find_or_add(const cell_style& style)
+	{
+		std::size_t slot = slot_of(style);
+		for (; slots[slot] != empty_slot; slot = (slot + 1) & (slots.size() - 1))
+		{
+			if (styles[slots[slot]] == style)
+				return slots[slot];
+		}
+
+		if (styles.size() == max_styles)
+			throw style_table_full_error();
+		const auto id = static_cast<style_id_t>(styles.size());
+		styles.push_back(style);
+		slots[slot] = id;
+		if (styles.size() * 2 > slots.size())
+			grow();
+		return id;
+	}
+
+	// Fibonacci hashing of the packed style, taking the top bits as the slot.
+	std::size_t style_table::slot_of(const cell_style& style) const noexcept
+	{
+		const std::uint64_t hash = style.to_packed() * 0x9e3779b97f4a7c15ull;
+		return static_cast<std::size_t>(hash >> 32) & (slots.size() - 1);
+	}
+
+	std::vector<style_id_t> style_table::compact(const std::vector<bool>& live)
+	{
+		std::vector<style_id_t> map(styles.size(), default_id);
+		std::size_t kept = 1;
+		for (std::size_t id = 1; id < styles.size(); ++id)
+		{
+			if (!live[id])
+				continue;
+			map[id] = static_cast<style_id_t>(kept);
+			styles[kept++] = styles[id];
+		}
+		styles.resize(kept);
+
+		last_style = styles[default_id];
+		last_id = default_id;
+		rehash(slots.size());
+		return map;
+	}
+
+	void style_table::grow()
+	{
+		rehash(slots.size() * 2);
+	}
+
+	void style_table::rehash(const std::size_t slot_count)
+	{
+		slots.assign(slot_count, empty_slot);
+		for (std::size_t id = 0; id < styles.size(); ++id)
+		{
+			std::size_t slot = slot_of(styles[id]);
+			while (slots[slot] != empty_slot)
+				slot = (slot + 1) & (slots.size() - 1);
+			slots[slot] = static_cast<style_id_t>(id);
+		}
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,74 @@
+//
+// Termwrap
+//
+// termwrap/style_table.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// style_table interns cell styles as 16-bit IDs. Cell buffers store an ID per cell rather than the two 32-bit
+// attribute words, so a screen takes a third less memory to diff and a style fill is a fill of one small integer.
+// An ID names the same style until the table is compacted; the default style is always ID 0. IDs are never reused
+// otherwise, so a table that has seen max_styles distinct styles is full until it is compacted.
+//
+// Styles are found by an open-addressing hash of their packed value. Drawing usually repeats the style it used last,
+// so that one is checked before the hash.
+
+#ifndef RHC_TERMWRAP_STYLE_TABLE_H
+#define RHC_TERMWRAP_STYLE_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "cell_style.hpp"
+
+namespace termwrap
+{
+	using style_id_t = std::uint16_t;
+
+	class style_table
+	{
+		std::vector<cell_style> styles{cell_style()};
+		// Each slot holds an ID, or empty_slot.
+		std::vector<style_id_t> slots{};
+		cell_style last_style{};
+		style_id_t last_id = default_id;
+
+		static constexpr style_id_t empty_slot = 0xffff;
+
+	public:
+		static constexpr style_id_t default_id = 0;
+		// One ID is kept back to mark empty slots.
+		static constexpr std::size_t max_styles = empty_slot;
+
+		style_table();
+
+		// The ID of a style, adding it if it is new. Throws style_table_full_error if max_styles are in use.
+		style_id_t intern(const cell_style& style)
+		{
+			if (style == last_style)
+				return last_id;
+			last_style = style;
+			last_id = find_or_add(style);
+			return last_id;
+		}
+
+		// Keeps the default style and the styles whose IDs are marked in live, which has an entry for every ID, and
+		// drops the rest. The styles kept are renumbered from 1 in their old order. Returns the new ID for each old
+		// one, with default_id for those dropped; everything holding IDs must be renumbered by it.
+		std::vector<style_id_t> compact(const std::vector<bool>& live);
+
+		const cell_style& operator[](const style_id_t id) const noexcept { return styles[id]; }
+		std::size_t size() const noexcept { return styles.size(); }
+
+	private:
+		style_id_t find_or_add(const cell_style& style);
+		std::size_t slot_of(const cell_style& style) const noexcept;
+		void grow();
+		void rehash(const std::size_t slot_count);
+	}; // End of class style_table.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_STYLE_TABLE_H.
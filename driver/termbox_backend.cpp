@@ -0,0 +1,149 @@
+//
+// Termwrap
+//
+// termwrap/termbox_backend.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "termbox_backend.hpp"
+
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+
+#include "/opt/termbox/include/termbox.h"
+#include "error.hpp"
+#include "key_translation.hpp"
+
+namespace termwrap
+{
+	// Terminals that take 24-bit colour say so in COLORTERM; otherwise TERM names 256 or 16 colours if the terminal
+	// has them. Anything else is assumed to have only the eight ANSI colours.
+	static color_depth detect_color_depth()
+	{
+		const char* const colorterm = std::getenv("COLORTERM");
+		if (colorterm && (std::strcmp(colorterm, "truecolor") == 0 || std::strcmp(colorterm, "24bit") == 0))
+			return color_depth::truecolor;
+
+		const char* const term = std::getenv("TERM");
+		if (term && std::strstr(term, "256color"))
+			return color_depth::palette;
+		if (term && std::strstr(term, "16color"))
+			return color_depth::bright;
+		return color_depth::basic;
+	}
+
+	termbox_backend::termbox_backend()
+	{
+		// Termbox takes the tty, and closes it on failure and at shutdown. It still puts the terminal into raw mode,
+		// but frames are written by termwrap's own encoder.
+		tty_fd = ::open("/dev/tty", O_RDWR | O_CLOEXEC);
+		if (tty_fd < 0)
+			throw failed_to_open_terminal_error();
+		int tb_status = tb_init_fd(tty_fd);
+		if (tb_status < 0)
+		{
+			switch (tb_status)
+			{
+				case TB_EUNSUPPORTED_TERMINAL:
+					throw unsupported_terminal_error();
+				case TB_EFAILED_TO_OPEN_TTY:
+					throw failed_to_open_terminal_error();
+				case TB_EPIPE_TRAP_ERROR:
+					throw pipe_trap_error();
+				default:
+					throw driver_unknown_error();
+			}
+		}
+
+		cached_width = tb_width();
+		cached_height = tb_height();
+		depth = detect_color_depth();
+		// An escape followed by a key is reported as the key with Alt.
+		set_mouse_reporting(false);
+	}
+
+	termbox_backend::~termbox_backend()
+	{
+		tb_shutdown();
+	}
+
+	// Termbox clears the screen when its own SIGWINCH handler reports a resize. A size found here has bypassed that,
+	// so the screen is cleared the same way, with the pen reset so that the erase uses the default colours; the
+	// driver relies on clears_on_resize() and redraws from a blank screen.
+	void termbox_backend::refresh_size()
+	{
+		struct winsize size{};
+		if (::ioctl(tty_fd, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 || size.ws_row == 0)
+			return;
+		if (size.ws_col == cached_width.load(std::memory_order_relaxed) && size.ws_row == cached_height.load(std::memory_order_relaxed))
+			return;
+
+		cached_width = size.ws_col;
+		cached_height = size.ws_row;
+		static constexpr char clear_sequence[] = "\x1b[m\x1b[H\x1b[2J";
+		write(clear_sequence, sizeof(clear_sequence) - 1);
+	}
+
+	void termbox_backend::write(const char* octets, std::size_t count)
+	{
+		while (count > 0)
+		{
+			const ssize_t written = ::write(tty_fd, octets, count);
+			if (written < 0)
+			{
+				if (errno == EINTR || errno == EAGAIN)
+					continue;
+				throw failed_write_error();
+			}
+			octets += written;
+			count -= written;
+		}
+	}
+
+	// Termbox may read more than one event from the tty at once. Input that is not an event is skipped without
+	// waiting again, so that nothing already read is left behind where an event loop watching the tty cannot see it.
+	std::optional<event> termbox_backend::poll_event(const unsigned wait_ms)
+	{
+		for (unsigned wait = wait_ms; ; wait = 0)
+		{
+			struct tb_event native_event{};
+
+			const int state = tb_peek_event(&native_event, wait);
+
+			if (state < 0)
+				throw failed_peek_poll_event();
+
+			const bool alt = native_event.mod & TB_MOD_ALT;
+			if (state == TB_EVENT_KEY)
+			{
+				if (const auto key = translate_key(native_event.key, native_event.ch, alt))
+					return *key;
+			}
+			else if (state == TB_EVENT_MOUSE)
+			{
+				if (const auto button = translate_mouse_button(native_event.key))
+					return mouse_event{*button, static_cast<ordinate_t>(native_event.x), static_cast<ordinate_t>(native_event.y), (native_event.mod & TB_MOD_MOTION) != 0, alt};
+			}
+			else if (state == TB_EVENT_RESIZE)
+			{
+				cached_width = native_event.w;
+				cached_height = native_event.h;
+				return {};
+			}
+			else
+				return {};
+		}
+	}
+
+	void termbox_backend::set_mouse_reporting(const bool enable)
+	{
+		tb_select_input_mode(TB_INPUT_ALT | (enable ? TB_INPUT_MOUSE : 0));
+	}
+
+} // End of namespace termwrap.
@@ -0,0 +1,58 @@
+//
+// Termwrap
+//
+// termwrap/termbox_backend.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// termbox_backend drives a real terminal. Termbox puts the tty into raw mode and decodes input; frames are written
+// directly to the tty. The tty is opened here and handed to termbox, so an event loop can wait on it. The size is
+// kept here too: termbox reports a resize only when its own SIGWINCH handler runs, which an event loop that takes
+// SIGWINCH itself prevents.
+
+#ifndef RHC_TERMWRAP_TERMBOX_BACKEND_H
+#define RHC_TERMWRAP_TERMBOX_BACKEND_H
+
+#include <atomic>
+#include <cstddef>
+#include <optional>
+
+#include "backend.hpp"
+#include "cell_style.hpp"
+#include "key_event.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	class termbox_backend : public backend
+	{
+		int tty_fd = -1;
+		// Updated by poll_event, which may run on an input thread.
+		std::atomic<ordinate_t> cached_width{0};
+		std::atomic<ordinate_t> cached_height{0};
+		color_depth depth = color_depth::basic;
+
+	public:
+		termbox_backend();
+		~termbox_backend();
+
+		termbox_backend(const termbox_backend& ) = delete;
+		termbox_backend& operator=(const termbox_backend& ) = delete;
+
+		ordinate_t width() const override { return cached_width.load(std::memory_order_relaxed); }
+		ordinate_t height() const override { return cached_height.load(std::memory_order_relaxed); }
+		bool clears_on_resize() const override { return true; }
+		color_depth colors() const override { return depth; }
+
+		void write(const char* const octets, const std::size_t count) override;
+		void write_control(const char* const octets, const std::size_t count) override { write(octets, count); }
+		std::optional<event> poll_event(const unsigned wait_ms) override;
+		void set_mouse_reporting(const bool enable) override;
+		int input_fd() const override { return tty_fd; }
+		void refresh_size() override;
+	}; // End of class termbox_backend.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_TERMBOX_BACKEND_H.
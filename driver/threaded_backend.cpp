@@ -0,0 +1,162 @@
+//
+// Termwrap
+//
+// termwrap/threaded_backend.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "threaded_backend.hpp"
+
+#include <csignal>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+#include "error.hpp"
+
+namespace termwrap
+{
+	namespace
+	{
+		// In a long burst the reader wakes the drawing thread every so many events, not only at the end.
+		constexpr std::size_t wake_every = 64;
+	} // End of anonymous namespace.
+
+	// The wrapped backend is taken only once the reader can be started, so that it is not lost if it cannot. The
+	// reader starts with every signal blocked, as a new thread inherits its creator's mask: signals are then never
+	// delivered to it, so neither termbox's SIGWINCH handler nor a signal meant for an event_loop runs there.
+	threaded_backend::threaded_backend(std::unique_ptr<backend>&& terminal)
+	{
+		wake_fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+		if (wake_fd < 0)
+			throw input_thread_error();
+
+		sigset_t all_signals;
+		sigset_t previous_mask;
+		sigfillset(&all_signals);
+		if (::pthread_sigmask(SIG_BLOCK, &all_signals, &previous_mask) != 0)
+		{
+			::close(wake_fd);
+			throw input_thread_error();
+		}
+
+		this->terminal = std::move(terminal);
+		try
+		{
+			reader = std::thread(&threaded_backend::read_input, this);
+		}
+		catch (...)
+		{
+			::pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+			terminal = std::move(this->terminal);
+			::close(wake_fd);
+			throw input_thread_error();
+		}
+		::pthread_sigmask(SIG_SETMASK, &previous_mask, nullptr);
+	}
+
+	threaded_backend::~threaded_backend()
+	{
+		stop();
+		::close(wake_fd);
+	}
+
+	std::unique_ptr<backend> threaded_backend::release()
+	{
+		stop();
+		const int mouse = mouse_request.exchange(-1, std::memory_order_acq_rel);
+		if (mouse >= 0)
+			terminal->set_mouse_reporting(mouse);
+		return std::move(terminal);
+	}
+
+	void threaded_backend::stop()
+	{
+		if (!reader.joinable())
+			return;
+		stopping.store(true, std::memory_order_release);
+		reader.join();
+	}
+
+	void threaded_backend::wake() noexcept
+	{
+		const std::uint64_t one = 1;
+		[[maybe_unused]] const ssize_t result = ::write(wake_fd, &one, sizeof(one));
+	}
+
+	// The reader waits for input, then takes everything else already waiting without waiting again, and wakes the
+	// drawing thread once for the burst. A resize is only noticed, as the wrapped backend keeps the size; the
+	// drawing thread is woken so that it polls and picks it up. If the ring is full, the reader waits for room,
+	// leaving further input unread.
+	void threaded_backend::read_input()
+	{
+		try
+		{
+			while (!stopping.load(std::memory_order_acquire))
+			{
+				const int mouse = mouse_request.exchange(-1, std::memory_order_acq_rel);
+				if (mouse >= 0)
+					terminal->set_mouse_reporting(mouse);
+
+				const ordinate_t old_width = terminal->width();
+				const ordinate_t old_height = terminal->height();
+				std::size_t pushed = 0;
+				for (std::optional<event> input = terminal->poll_event(poll_interval_ms); input; input = terminal->poll_event(0))
+				{
+					timed_event timed{std::move(*input), std::chrono::steady_clock::now()};
+					while (!ring.try_push(std::move(timed)))
+					{
+						wake();
+						if (stopping.load(std::memory_order_acquire))
+							return;
+						std::this_thread::sleep_for(std::chrono::milliseconds(1));
+					}
+					if (++pushed % wake_every == 0)
+						wake();
+				}
+
+				if (pushed % wake_every != 0 || terminal->width() != old_width || terminal->height() != old_height)
+					wake();
+			}
+		}
+		catch (...)
+		{
+			reader_error = std::current_exception();
+			reader_failed.store(true, std::memory_order_release);
+			wake();
+		}
+	}
+
+	// The eventfd is cleared before the ring is checked a second time, so an event pushed in between still leaves
+	// it signalled. An error in the reader is raised once the events read before it have been handed out.
+	std::optional<event> threaded_backend::poll_event(const unsigned wait_ms)
+	{
+		auto next = ring.try_pop();
+		if (!next)
+		{
+			std::uint64_t count;
+			[[maybe_unused]] const ssize_t result = ::read(wake_fd, &count, sizeof(count));
+			next = ring.try_pop();
+		}
+		if (!next && reader_failed.exchange(false, std::memory_order_acquire))
+			std::rethrow_exception(reader_error);
+		if (!next && wait_ms > 0)
+		{
+			struct pollfd wake_poll{wake_fd, POLLIN, 0};
+			::poll(&wake_poll, 1, static_cast<int>(wait_ms));
+			next = ring.try_pop();
+		}
+		if (!next)
+			return {};
+
+		const auto waited = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - next->read_at);
+		++latency.events;
+		latency.total += waited;
+		if (waited > latency.max)
+			latency.max = waited;
+		return std::move(next->input);
+	}
+} // End of namespace termwrap.
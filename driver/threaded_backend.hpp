@@ -0,0 +1,107 @@
+//
+// Termwrap
+//
+// termwrap/threaded_backend.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// threaded_backend wraps another backend and moves its read side onto a thread of its own. The thread waits on the
+// wrapped backend for input, which termbox decodes there, and pushes each event into a lock-free ring with the time
+// it was read. The thread that draws pops events from the ring, so a slow frame never holds up reading, and input
+// is never queued behind one. Its input fd is an eventfd that the reader signals after each burst, so an event_loop
+// can wait on it as it would on the tty.
+//
+// Everything but reading happens on the calling thread, as before, so the wrapped backend must allow poll_event and
+// set_mouse_reporting on one thread while the rest are called on another, as termbox_backend does and
+// headless_backend does not. A change of mouse reporting is passed to the reader, which applies it before it next
+// waits, within poll_interval_ms. The reader blocks every signal, so it may be started before or after an event_loop.
+
+#ifndef RHC_TERMWRAP_THREADED_BACKEND_H
+#define RHC_TERMWRAP_THREADED_BACKEND_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <thread>
+
+#include "backend.hpp"
+#include "cell_style.hpp"
+#include "event.hpp"
+#include "spsc_ring.hpp"
+#include "types.hpp"
+
+namespace termwrap
+{
+	// Time from an event being read by the input thread to its being popped by the thread that draws.
+	struct input_latency
+	{
+		std::uint64_t events = 0;
+		std::chrono::nanoseconds total{0};
+		std::chrono::nanoseconds max{0};
+
+		std::chrono::nanoseconds mean() const noexcept { return events ? total / static_cast<std::chrono::nanoseconds::rep>(events) : std::chrono::nanoseconds{0}; }
+	};
+
+	class threaded_backend : public backend
+	{
+		struct timed_event
+		{
+			event input;
+			std::chrono::steady_clock::time_point read_at;
+		};
+
+		static constexpr std::size_t ring_capacity = 1024;
+		// How long the reader waits on the wrapped backend before checking whether it should stop.
+		static constexpr unsigned poll_interval_ms = 50;
+
+		std::unique_ptr<backend> terminal;
+		spsc_ring<timed_event, ring_capacity> ring{};
+		int wake_fd = -1;
+		std::thread reader{};
+		std::atomic<bool> stopping{false};
+		// -1 if unchanged, otherwise whether mouse reporting should be on.
+		std::atomic<int> mouse_request{-1};
+		// Set by the reader if the wrapped backend throws; rethrown by poll_event.
+		std::exception_ptr reader_error{};
+		std::atomic<bool> reader_failed{false};
+		input_latency latency{};
+
+	public:
+		explicit threaded_backend(std::unique_ptr<backend>&& terminal);
+		~threaded_backend();
+
+		threaded_backend(const threaded_backend& ) = delete;
+		threaded_backend& operator=(const threaded_backend& ) = delete;
+
+		ordinate_t width() const override { return terminal->width(); }
+		ordinate_t height() const override { return terminal->height(); }
+		bool clears_on_resize() const override { return terminal->clears_on_resize(); }
+		color_depth colors() const override { return terminal->colors(); }
+
+		void write(const char* const octets, const std::size_t count) override { terminal->write(octets, count); }
+		void write_control(const char* const octets, const std::size_t count) override { terminal->write_control(octets, count); }
+		std::optional<event> poll_event(const unsigned wait_ms) override;
+		void set_mouse_reporting(const bool enable) override { mouse_request.store(enable, std::memory_order_release); }
+		int input_fd() const override { return wake_fd; }
+		void refresh_size() override { terminal->refresh_size(); }
+
+		const input_latency& get_latency() const noexcept { return latency; }
+		void reset_latency() noexcept { latency = input_latency{}; }
+
+		// Stops the reader and hands back the wrapped backend. Events already read stay in the ring for poll_event.
+		std::unique_ptr<backend> release();
+
+	private:
+		void stop();
+		void read_input();
+		void wake() noexcept;
+	}; // End of class threaded_backend.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_THREADED_BACKEND_H.
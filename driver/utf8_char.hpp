@@ -12,45 +12,37 @@
 
 #include <cstddef>
 #include <cstdint>
-#include <iterator>
-#include <string>
-#include "/opt/utf8/source/utf8.h"
+#include <memory>
 
 namespace termwrap
 {
 	using std::uint32_t;
 
-	struct utf8_char
+	template <class Alloc>
+	class basic_utf8_string;
+
+	// A reference to one code point of a basic_utf8_string, returned by its non-const accessors. Assigning through
+	// it goes through the owning string so that the string's code-point index stays correct. The members are
+	// defined in utf8_string.hpp, once basic_utf8_string is complete.
+	template <class Alloc>
+	struct basic_utf8_char
 	{
-		utf8_char(std::string& octet_storage, const std::string::pointer octet_start)
-			: octet_storage(octet_storage), octet_start(octet_start)
+		basic_utf8_char(basic_utf8_string<Alloc>& owner, const std::size_t position)
+			: owner(owner), position(position)
 		{ }
 
-		operator uint32_t() const noexcept
-		{
-			auto temp = utf8::unchecked::iterator(octet_start);
-			return *temp;
-		}
-
-		utf8_char& operator=(const uint32_t cp)
-		{
-			auto begin = utf8::unchecked::iterator(octet_start);
-			auto end = utf8::unchecked::iterator(octet_start);
-			std::next(end);
-			const auto it = octet_storage.erase(std::string::iterator(begin.base()), std::string::iterator(end.base()));
-			utf8::append(cp, std::inserter(octet_storage, it));
-			return *this;
-		}
-
-		std::string::const_pointer operator&() const noexcept
-		{
-			return octet_start;
-		}
+		operator uint32_t() const;
+
+		basic_utf8_char& operator=(const uint32_t cp);
+
+		const char* operator&() const;
 
 		private:
-			std::string& octet_storage;			
-			const std::string::pointer octet_start;
-	}; // End of struct utf8_char.
+			basic_utf8_string<Alloc>& owner;
+			const std::size_t position;
+	}; // End of struct basic_utf8_char.
+
+	using utf8_char = basic_utf8_char<std::allocator<char>>;
 } // End of namespace termwrap.
 
 #endif // !RHC_TERMWRAP_UTF8_CHAR_H.
@@ -0,0 +1,486 @@
+//
+// Termwrap
+//
+// termwrap/utf8_search.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "utf8_search.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RHC_TERMWRAP_X86 1
+#endif
+
+namespace termwrap
+{
+	namespace
+	{
+		using octet_t = unsigned char;
+
+		bool is_continuation(const octet_t octet) noexcept
+		{
+			return (octet & 0xc0) == 0x80;
+		}
+
+		// The length of the sequence that lead starts, which must not be a continuation octet.
+		std::size_t sequence_length(const octet_t lead) noexcept
+		{
+			return (lead < 0x80) ? 1 : (lead < 0xe0) ? 2 : (lead < 0xf0) ? 3 : 4;
+		}
+
+		// The code points of a set given as UTF-8. ASCII members are looked up in a table; any other candidate is
+		// looked for in the set's octets. The distinct lead octets are kept for the vector kernels, which test each
+		// against every octet and so fall back to scalar code if there are more than max_leads of them.
+		class code_point_set
+		{
+		public:
+			static constexpr std::size_t max_leads = 8;
+
+		private:
+			std::string_view octets;
+			bool ascii[128] = {};
+			octet_t leads[max_leads] = {};
+			std::size_t lead_count = 0;
+			bool many_leads = false;
+
+		public:
+			code_point_set(const char* const set, const std::size_t size) noexcept
+				: octets(set, size)
+			{
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					const octet_t octet = set[i];
+					if (is_continuation(octet))
+						continue;
+					if (octet < 0x80)
+						ascii[octet] = true;
+					if (std::find(leads, leads + lead_count, octet) != leads + lead_count)
+						continue;
+					if (lead_count == max_leads)
+						many_leads = true;
+					else
+						leads[lead_count++] = octet;
+				}
+			}
+
+			// Whether the code point starting at p, with available octets from there to the end of the text, is in
+			// the set.
+			bool contains(const octet_t* const p, const std::size_t available) const noexcept
+			{
+				if (*p < 0x80)
+					return ascii[*p];
+				const std::size_t length = std::min(sequence_length(*p), available);
+				return octets.find(std::string_view(reinterpret_cast<const char*>(p), length)) != std::string_view::npos;
+			}
+
+			bool has_many_leads() const noexcept { return many_leads; }
+			std::size_t lead_total() const noexcept { return lead_count; }
+			octet_t lead(const std::size_t k) const noexcept { return leads[k]; }
+		}; // End of class code_point_set.
+
+		//
+		// Scalar kernels, which also finish the octets left over after the last whole vector.
+		//
+		std::size_t find_scalar(const octet_t* const octets, const std::size_t size, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			const std::string_view text(reinterpret_cast<const char*>(octets), size);
+			const auto at = text.find(std::string_view(reinterpret_cast<const char*>(needle), needle_size));
+			return (at == std::string_view::npos) ? size : at;
+		}
+
+		// Looks for the last occurrence that starts before end, returning size if there is none.
+		std::size_t find_last_scalar(const octet_t* const octets, const std::size_t size, const std::size_t end, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			if (end == 0)
+				return size;
+			const std::string_view text(reinterpret_cast<const char*>(octets), std::min(size, end - 1 + needle_size));
+			const auto at = text.rfind(std::string_view(reinterpret_cast<const char*>(needle), needle_size));
+			return (at == std::string_view::npos) ? size : at;
+		}
+
+		// Looks from begin onwards, returning size if there is no match.
+		std::size_t find_first_of_scalar(const octet_t* const octets, const std::size_t size, const std::size_t begin, const code_point_set& set) noexcept
+		{
+			for (std::size_t i = begin; i < size; ++i)
+			{
+				if (!is_continuation(octets[i]) && set.contains(octets + i, size - i))
+					return i;
+			}
+			return size;
+		}
+
+		// Looks before end, returning size if there is no match.
+		std::size_t find_last_of_scalar(const octet_t* const octets, const std::size_t size, const std::size_t end, const code_point_set& set) noexcept
+		{
+			for (std::size_t i = end; i > 0; --i)
+			{
+				if (!is_continuation(octets[i-1]) && set.contains(octets + i - 1, size - i + 1))
+					return i - 1;
+			}
+			return size;
+		}
+
+#ifdef RHC_TERMWRAP_X86
+		__attribute__((target("sse2")))
+		inline __m128i load128(const void* const p)
+		{
+			return _mm_loadu_si128(static_cast<const __m128i*>(p));
+		}
+
+		__attribute__((target("avx2")))
+		inline __m256i load256(const void* const p)
+		{
+			return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+		}
+
+		// The vector kernels look at a block of this many positions between branches.
+		constexpr std::size_t block = 64;
+
+		__attribute__((target("sse2")))
+		inline std::uint64_t candidate_mask_sse2(const octet_t* const p, const std::size_t last, const __m128i first_octet, const __m128i last_octet)
+		{
+			return _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(load128(p), first_octet), _mm_cmpeq_epi8(load128(p + last), last_octet)));
+		}
+
+		// Bit k is set if a match of needle could start at p+k: its first and last octets are both in place.
+		__attribute__((target("sse2")))
+		inline std::uint64_t candidate_block_sse2(const octet_t* const p, const std::size_t last, const __m128i first_octet, const __m128i last_octet)
+		{
+			return candidate_mask_sse2(p, last, first_octet, last_octet) | candidate_mask_sse2(p + 16, last, first_octet, last_octet) << 16
+				| candidate_mask_sse2(p + 32, last, first_octet, last_octet) << 32 | candidate_mask_sse2(p + 48, last, first_octet, last_octet) << 48;
+		}
+
+		__attribute__((target("avx2")))
+		inline std::uint64_t candidate_mask_avx2(const octet_t* const p, const std::size_t last, const __m256i first_octet, const __m256i last_octet)
+		{
+			return static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(load256(p), first_octet), _mm256_cmpeq_epi8(load256(p + last), last_octet))));
+		}
+
+		__attribute__((target("avx2")))
+		inline std::uint64_t candidate_block_avx2(const octet_t* const p, const std::size_t last, const __m256i first_octet, const __m256i last_octet)
+		{
+			return candidate_mask_avx2(p, last, first_octet, last_octet) | candidate_mask_avx2(p + 32, last, first_octet, last_octet) << 32;
+		}
+
+		__attribute__((target("sse2")))
+		std::size_t find_sse2(const octet_t* const octets, const std::size_t size, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			if (needle_size > size)
+				return size;
+			const std::size_t last = needle_size - 1;
+			const __m128i first_octet = _mm_set1_epi8(needle[0]);
+			const __m128i last_octet = _mm_set1_epi8(needle[last]);
+
+			std::size_t i = 0;
+			for (; i + last + block <= size; i += block)
+			{
+				for (std::uint64_t mask = candidate_block_sse2(octets + i, last, first_octet, last_octet); mask; mask &= mask - 1)
+				{
+					const std::size_t at = i + __builtin_ctzll(mask);
+					if (std::memcmp(octets + at, needle, needle_size) == 0)
+						return at;
+				}
+			}
+			const std::size_t rest = find_scalar(octets + i, size - i, needle, needle_size);
+			return (rest == size - i) ? size : i + rest;
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t find_avx2(const octet_t* const octets, const std::size_t size, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			if (needle_size > size)
+				return size;
+			const std::size_t last = needle_size - 1;
+			const __m256i first_octet = _mm256_set1_epi8(needle[0]);
+			const __m256i last_octet = _mm256_set1_epi8(needle[last]);
+
+			std::size_t i = 0;
+			for (; i + last + block <= size; i += block)
+			{
+				for (std::uint64_t mask = candidate_block_avx2(octets + i, last, first_octet, last_octet); mask; mask &= mask - 1)
+				{
+					const std::size_t at = i + __builtin_ctzll(mask);
+					if (std::memcmp(octets + at, needle, needle_size) == 0)
+						return at;
+				}
+			}
+			const std::size_t rest = find_scalar(octets + i, size - i, needle, needle_size);
+			return (rest == size - i) ? size : i + rest;
+		}
+
+		// Blocks of candidate starts are taken from the end backwards, and each block from its highest bit.
+		__attribute__((target("sse2")))
+		std::size_t find_last_sse2(const octet_t* const octets, const std::size_t size, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			if (needle_size > size)
+				return size;
+			const std::size_t last = needle_size - 1;
+			const __m128i first_octet = _mm_set1_epi8(needle[0]);
+			const __m128i last_octet = _mm_set1_epi8(needle[last]);
+
+			std::size_t end = size - last;
+			for (; end >= block; end -= block)
+			{
+				const std::size_t i = end - block;
+				for (std::uint64_t mask = candidate_block_sse2(octets + i, last, first_octet, last_octet); mask; )
+				{
+					const unsigned bit = 63 - __builtin_clzll(mask);
+					if (std::memcmp(octets + i + bit, needle, needle_size) == 0)
+						return i + bit;
+					mask &= ~(std::uint64_t{1} << bit);
+				}
+			}
+			return find_last_scalar(octets, size, end, needle, needle_size);
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t find_last_avx2(const octet_t* const octets, const std::size_t size, const octet_t* const needle, const std::size_t needle_size) noexcept
+		{
+			if (needle_size > size)
+				return size;
+			const std::size_t last = needle_size - 1;
+			const __m256i first_octet = _mm256_set1_epi8(needle[0]);
+			const __m256i last_octet = _mm256_set1_epi8(needle[last]);
+
+			std::size_t end = size - last;
+			for (; end >= block; end -= block)
+			{
+				const std::size_t i = end - block;
+				for (std::uint64_t mask = candidate_block_avx2(octets + i, last, first_octet, last_octet); mask; )
+				{
+					const unsigned bit = 63 - __builtin_clzll(mask);
+					if (std::memcmp(octets + i + bit, needle, needle_size) == 0)
+						return i + bit;
+					mask &= ~(std::uint64_t{1} << bit);
+				}
+			}
+			return find_last_scalar(octets, size, end, needle, needle_size);
+		}
+
+		__attribute__((target("sse2")))
+		inline std::uint64_t lead_mask_sse2(const octet_t* const p, const __m128i* const leads, const std::size_t lead_count)
+		{
+			const __m128i v = load128(p);
+			__m128i any = _mm_setzero_si128();
+			for (std::size_t k = 0; k < lead_count; ++k)
+				any = _mm_or_si128(any, _mm_cmpeq_epi8(v, leads[k]));
+			return _mm_movemask_epi8(any);
+		}
+
+		// Bit k is set if p[k] is the lead octet of some member of the set.
+		__attribute__((target("sse2")))
+		inline std::uint64_t lead_block_sse2(const octet_t* const p, const __m128i* const leads, const std::size_t lead_count)
+		{
+			return lead_mask_sse2(p, leads, lead_count) | lead_mask_sse2(p + 16, leads, lead_count) << 16
+				| lead_mask_sse2(p + 32, leads, lead_count) << 32 | lead_mask_sse2(p + 48, leads, lead_count) << 48;
+		}
+
+		__attribute__((target("avx2")))
+		inline std::uint64_t lead_mask_avx2(const octet_t* const p, const __m256i* const leads, const std::size_t lead_count)
+		{
+			const __m256i v = load256(p);
+			__m256i any = _mm256_setzero_si256();
+			for (std::size_t k = 0; k < lead_count; ++k)
+				any = _mm256_or_si256(any, _mm256_cmpeq_epi8(v, leads[k]));
+			return static_cast<std::uint32_t>(_mm256_movemask_epi8(any));
+		}
+
+		__attribute__((target("avx2")))
+		inline std::uint64_t lead_block_avx2(const octet_t* const p, const __m256i* const leads, const std::size_t lead_count)
+		{
+			return lead_mask_avx2(p, leads, lead_count) | lead_mask_avx2(p + 32, leads, lead_count) << 32;
+		}
+
+		__attribute__((target("sse2")))
+		std::size_t find_first_of_sse2(const octet_t* const octets, const std::size_t size, const code_point_set& set) noexcept
+		{
+			if (set.has_many_leads())
+				return find_first_of_scalar(octets, size, 0, set);
+			__m128i leads[code_point_set::max_leads];
+			for (std::size_t k = 0; k < set.lead_total(); ++k)
+				leads[k] = _mm_set1_epi8(set.lead(k));
+
+			std::size_t i = 0;
+			for (; i + block <= size; i += block)
+			{
+				for (std::uint64_t mask = lead_block_sse2(octets + i, leads, set.lead_total()); mask; mask &= mask - 1)
+				{
+					const std::size_t at = i + __builtin_ctzll(mask);
+					if (set.contains(octets + at, size - at))
+						return at;
+				}
+			}
+			return find_first_of_scalar(octets, size, i, set);
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t find_first_of_avx2(const octet_t* const octets, const std::size_t size, const code_point_set& set) noexcept
+		{
+			if (set.has_many_leads())
+				return find_first_of_scalar(octets, size, 0, set);
+			__m256i leads[code_point_set::max_leads];
+			for (std::size_t k = 0; k < set.lead_total(); ++k)
+				leads[k] = _mm256_set1_epi8(set.lead(k));
+
+			std::size_t i = 0;
+			for (; i + block <= size; i += block)
+			{
+				for (std::uint64_t mask = lead_block_avx2(octets + i, leads, set.lead_total()); mask; mask &= mask - 1)
+				{
+					const std::size_t at = i + __builtin_ctzll(mask);
+					if (set.contains(octets + at, size - at))
+						return at;
+				}
+			}
+			return find_first_of_scalar(octets, size, i, set);
+		}
+
+		__attribute__((target("sse2")))
+		std::size_t find_last_of_sse2(const octet_t* const octets, const std::size_t size, const code_point_set& set) noexcept
+		{
+			if (set.has_many_leads())
+				return find_last_of_scalar(octets, size, size, set);
+			__m128i leads[code_point_set::max_leads];
+			for (std::size_t k = 0; k < set.lead_total(); ++k)
+				leads[k] = _mm_set1_epi8(set.lead(k));
+
+			std::size_t end = size;
+			for (; end >= block; end -= block)
+			{
+				const std::size_t i = end - block;
+				for (std::uint64_t mask = lead_block_sse2(octets + i, leads, set.lead_total()); mask; )
+				{
+					const unsigned bit = 63 - __builtin_clzll(mask);
+					if (set.contains(octets + i + bit, size - i - bit))
+						return i + bit;
+					mask &= ~(std::uint64_t{1} << bit);
+				}
+			}
+			return find_last_of_scalar(octets, size, end, set);
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t find_last_of_avx2(const octet_t* const octets, const std::size_t size, const code_point_set& set) noexcept
+		{
+			if (set.has_many_leads())
+				return find_last_of_scalar(octets, size, size, set);
+			__m256i leads[code_point_set::max_leads];
+			for (std::size_t k = 0; k < set.lead_total(); ++k)
+				leads[k] = _mm256_set1_epi8(set.lead(k));
+
+			std::size_t end = size;
+			for (; end >= block; end -= block)
+			{
+				const std::size_t i = end - block;
+				for (std::uint64_t mask = lead_block_avx2(octets + i, leads, set.lead_total()); mask; )
+				{
+					const unsigned bit = 63 - __builtin_clzll(mask);
+					if (set.contains(octets + i + bit, size - i - bit))
+						return i + bit;
+					mask &= ~(std::uint64_t{1} << bit);
+				}
+			}
+			return find_last_of_scalar(octets, size, end, set);
+		}
+#endif
+
+		const octet_t* as_octets(const char* const octets) noexcept
+		{
+			return reinterpret_cast<const octet_t*>(octets);
+		}
+	} // End of anonymous namespace.
+
+	std::size_t utf8_find(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return find_avx2(as_octets(octets), size, as_octets(needle), needle_size);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return find_sse2(as_octets(octets), size, as_octets(needle), needle_size);
+#endif
+			default:
+				return find_scalar(as_octets(octets), size, as_octets(needle), needle_size);
+		}
+	}
+
+	std::size_t utf8_find_last(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return find_last_avx2(as_octets(octets), size, as_octets(needle), needle_size);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return find_last_sse2(as_octets(octets), size, as_octets(needle), needle_size);
+#endif
+			default:
+				return find_last_scalar(as_octets(octets), size, size, as_octets(needle), needle_size);
+		}
+	}
+
+	std::size_t utf8_find_first_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size, const simd_level level) noexcept
+	{
+		const code_point_set members(set, set_size);
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return find_first_of_avx2(as_octets(octets), size, members);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return find_first_of_sse2(as_octets(octets), size, members);
+#endif
+			default:
+				return find_first_of_scalar(as_octets(octets), size, 0, members);
+		}
+	}
+
+	std::size_t utf8_find_last_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size, const simd_level level) noexcept
+	{
+		const code_point_set members(set, set_size);
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return find_last_of_avx2(as_octets(octets), size, members);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return find_last_of_sse2(as_octets(octets), size, members);
+#endif
+			default:
+				return find_last_of_scalar(as_octets(octets), size, size, members);
+		}
+	}
+
+	std::size_t utf8_find(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size) noexcept
+	{
+		return utf8_find(octets, size, needle, needle_size, active_simd_level());
+	}
+
+	std::size_t utf8_find_last(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size) noexcept
+	{
+		return utf8_find_last(octets, size, needle, needle_size, active_simd_level());
+	}
+
+	std::size_t utf8_find_first_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size) noexcept
+	{
+		return utf8_find_first_of(octets, size, set, set_size, active_simd_level());
+	}
+
+	std::size_t utf8_find_last_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size) noexcept
+	{
+		return utf8_find_last_of(octets, size, set, set_size, active_simd_level());
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,44 @@
+//
+// Termwrap
+//
+// termwrap/utf8_search.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Searching UTF-8 text by octets. Because UTF-8 is self-synchronizing, a well-formed needle found in well-formed
+// text always starts on a code point, so no decoding is needed to search. Candidates are found a vector at a time
+// (SSE2, AVX2) by comparing the first and last octets of the needle at once, or the lead octets of a set of code
+// points, and only those candidates are compared in full. The overloads taking a simd_level are for benchmarking and
+// testing against one another.
+//
+// Each function returns an octet offset, or size if there is no match. Needles must not be empty.
+
+#ifndef RHC_TERMWRAP_UTF8_SEARCH_H
+#define RHC_TERMWRAP_UTF8_SEARCH_H
+
+#include <cstddef>
+
+#include "simd.hpp"
+
+namespace termwrap
+{
+	// Returns the offset of the first occurrence of needle in the octets.
+	std::size_t utf8_find(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size) noexcept;
+	std::size_t utf8_find(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size, const simd_level level) noexcept;
+
+	// Returns the offset of the last occurrence of needle in the octets.
+	std::size_t utf8_find_last(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size) noexcept;
+	std::size_t utf8_find_last(const char* const octets, const std::size_t size, const char* const needle, const std::size_t needle_size, const simd_level level) noexcept;
+
+	// Returns the offset of the first code point in the octets that is one of the code points of set.
+	std::size_t utf8_find_first_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size) noexcept;
+	std::size_t utf8_find_first_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size, const simd_level level) noexcept;
+
+	// Returns the offset of the last code point in the octets that is one of the code points of set.
+	std::size_t utf8_find_last_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size) noexcept;
+	std::size_t utf8_find_last_of(const char* const octets, const std::size_t size, const char* const set, const std::size_t set_size, const simd_level level) noexcept;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_UTF8_SEARCH_H.
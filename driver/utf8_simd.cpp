@@ -0,0 +1,662 @@
+//
+// Termwrap
+//
+// termwrap/utf8_simd.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "utf8_simd.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RHC_TERMWRAP_X86 1
+#endif
+
+namespace termwrap
+{
+	namespace
+	{
+		using octet_t = unsigned char;
+
+		constexpr std::uint32_t replacement_character = 0xfffd;
+
+		bool is_continuation(const octet_t octet) noexcept
+		{
+			return (octet & 0xc0) == 0x80;
+		}
+
+		//
+		// Scalar kernels, which also finish the octets left over after the last whole vector.
+		//
+		std::size_t count_scalar(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			return std::count_if(octets, octets + size, [](const octet_t octet) { return !is_continuation(octet); });
+		}
+
+		bool is_ascii_scalar(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			return std::all_of(octets, octets + size, [](const octet_t octet) { return octet < 0x80; });
+		}
+
+		std::size_t offset_scalar(const octet_t* const octets, const std::size_t size, std::size_t n) noexcept
+		{
+			for (std::size_t i = 0; i < size; ++i)
+			{
+				if (is_continuation(octets[i]))
+					continue;
+				if (n == 0)
+					return i;
+				--n;
+			}
+			return size;
+		}
+
+		bool validate_scalar(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			std::size_t i = 0;
+			while (i < size)
+			{
+				const octet_t lead = octets[i];
+				if (lead < 0x80)
+				{
+					++i;
+					continue;
+				}
+
+				std::size_t length;
+				std::uint32_t cp;
+				if (lead >= 0xc2 && lead <= 0xdf)
+					length = 2, cp = lead & 0x1f;
+				else if ((lead & 0xf0) == 0xe0)
+					length = 3, cp = lead & 0x0f;
+				else if (lead >= 0xf0 && lead <= 0xf4)
+					length = 4, cp = lead & 0x07;
+				else
+					return false;
+
+				if (size - i < length)
+					return false;
+				for (std::size_t k = 1; k < length; ++k)
+				{
+					if (!is_continuation(octets[i+k]))
+						return false;
+					cp = (cp << 6) | (octets[i+k] & 0x3f);
+				}
+				if ((length == 3 && cp < 0x800) || (length == 4 && (cp < 0x10000 || cp > 0x10ffff)) || (cp >= 0xd800 && cp <= 0xdfff))
+					return false;
+				i += length;
+			}
+			return true;
+		}
+
+		// Decodes the sequence at octets into cp and returns its length, or 0 if it runs past the available octets.
+		std::size_t decode_one(const octet_t* const octets, const std::size_t available, std::uint32_t& cp) noexcept
+		{
+			const octet_t lead = octets[0];
+			if (lead < 0x80)
+			{
+				cp = lead;
+				return 1;
+			}
+			if (lead < 0xc0)
+			{
+				cp = replacement_character;
+				return 1;
+			}
+
+			const std::size_t length = (lead < 0xe0) ? 2 : (lead < 0xf0) ? 3 : 4;
+			if (available < length)
+				return 0;
+			cp = lead & (0x7f >> length);
+			for (std::size_t k = 1; k < length; ++k)
+				cp = (cp << 6) | (octets[k] & 0x3f);
+			return length;
+		}
+
+		std::size_t decode_scalar(const octet_t* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed) noexcept
+		{
+			std::size_t i = 0;
+			std::size_t written = 0;
+			while (written < max_code_points && i < size)
+			{
+				const std::size_t length = decode_one(octets + i, size - i, out[written]);
+				if (length == 0)
+					break;
+				++written;
+				i += length;
+			}
+			octets_consumed = i;
+			return written;
+		}
+
+		// Returns the position of set bit n (counting from zero) of mask, which must have more than n bits set.
+		unsigned nth_set_bit(std::uint32_t mask, std::size_t n) noexcept
+		{
+			for (; n > 0; --n)
+				mask &= mask - 1;
+			return __builtin_ctz(mask);
+		}
+
+#ifdef RHC_TERMWRAP_X86
+		__attribute__((target("sse2")))
+		inline __m128i load128(const void* const p)
+		{
+			return _mm_loadu_si128(static_cast<const __m128i*>(p));
+		}
+
+		__attribute__((target("avx2")))
+		inline __m256i load256(const void* const p)
+		{
+			return _mm256_loadu_si256(static_cast<const __m256i*>(p));
+		}
+
+		// Compared as signed octets, only the continuation octets 0x80 to 0xbf are not greater than -65.
+		constexpr char continuation_limit = -65;
+
+		__attribute__((target("sse2")))
+		inline std::uint32_t lead_mask_sse2(const octet_t* const p)
+		{
+			return _mm_movemask_epi8(_mm_cmpgt_epi8(load128(p), _mm_set1_epi8(continuation_limit)));
+		}
+
+		__attribute__((target("avx2")))
+		inline std::uint32_t lead_mask_avx2(const octet_t* const p)
+		{
+			return _mm256_movemask_epi8(_mm256_cmpgt_epi8(load256(p), _mm256_set1_epi8(continuation_limit)));
+		}
+
+		// Four vectors are ORed together between tests of the high bits, so a long ASCII run costs one branch per
+		// 64 octets.
+		__attribute__((target("sse2")))
+		bool is_ascii_sse2(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + 64 <= size; i += 64)
+			{
+				const __m128i any = _mm_or_si128(_mm_or_si128(load128(octets + i), load128(octets + i + 16)), _mm_or_si128(load128(octets + i + 32), load128(octets + i + 48)));
+				if (_mm_movemask_epi8(any))
+					return false;
+			}
+			for (; i + 16 <= size; i += 16)
+			{
+				if (_mm_movemask_epi8(load128(octets + i)))
+					return false;
+			}
+			return is_ascii_scalar(octets + i, size - i);
+		}
+
+		__attribute__((target("avx2")))
+		bool is_ascii_avx2(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + 128 <= size; i += 128)
+			{
+				const __m256i any = _mm256_or_si256(_mm256_or_si256(load256(octets + i), load256(octets + i + 32)), _mm256_or_si256(load256(octets + i + 64), load256(octets + i + 96)));
+				if (_mm256_movemask_epi8(any))
+					return false;
+			}
+			for (; i + 32 <= size; i += 32)
+			{
+				if (_mm256_movemask_epi8(load256(octets + i)))
+					return false;
+			}
+			return is_ascii_scalar(octets + i, size - i);
+		}
+
+		// Lead octets are tallied per lane by subtracting the all-ones compare results, for up to 255 vectors before
+		// a lane could overflow, and then summed horizontally with psadbw.
+		__attribute__((target("sse2")))
+		std::size_t count_sse2(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			const __m128i zero = _mm_setzero_si128();
+			const __m128i limit = _mm_set1_epi8(continuation_limit);
+			std::size_t count = 0;
+			std::size_t i = 0;
+			while (i + 16 <= size)
+			{
+				const std::size_t vectors = std::min<std::size_t>((size - i) / 16, 255);
+				__m128i tally = zero;
+				for (std::size_t k = 0; k < vectors; ++k, i += 16)
+					tally = _mm_sub_epi8(tally, _mm_cmpgt_epi8(load128(octets + i), limit));
+				const __m128i sums = _mm_sad_epu8(tally, zero);
+				count += _mm_extract_epi16(sums, 0) + _mm_extract_epi16(sums, 4);
+			}
+			return count + count_scalar(octets + i, size - i);
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t count_avx2(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			const __m256i zero = _mm256_setzero_si256();
+			const __m256i limit = _mm256_set1_epi8(continuation_limit);
+			std::size_t count = 0;
+			std::size_t i = 0;
+			while (i + 32 <= size)
+			{
+				const std::size_t vectors = std::min<std::size_t>((size - i) / 32, 255);
+				__m256i tally = zero;
+				for (std::size_t k = 0; k < vectors; ++k, i += 32)
+					tally = _mm256_sub_epi8(tally, _mm256_cmpgt_epi8(load256(octets + i), limit));
+				const __m256i sums = _mm256_sad_epu8(tally, zero);
+				count += _mm256_extract_epi16(sums, 0) + _mm256_extract_epi16(sums, 4) + _mm256_extract_epi16(sums, 8) + _mm256_extract_epi16(sums, 12);
+			}
+			return count + count_scalar(octets + i, size - i);
+		}
+
+		__attribute__((target("sse2")))
+		std::size_t offset_sse2(const octet_t* const octets, const std::size_t size, std::size_t n) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16)
+			{
+				const std::uint32_t mask = lead_mask_sse2(octets + i);
+				const std::size_t count = __builtin_popcount(mask);
+				if (count > n)
+					return i + nth_set_bit(mask, n);
+				n -= count;
+			}
+			return i + offset_scalar(octets + i, size - i, n);
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t offset_avx2(const octet_t* const octets, const std::size_t size, std::size_t n) noexcept
+		{
+			std::size_t i = 0;
+			for (; i + 32 <= size; i += 32)
+			{
+				const std::uint32_t mask = lead_mask_avx2(octets + i);
+				const std::size_t count = __builtin_popcount(mask);
+				if (count > n)
+					return i + nth_set_bit(mask, n);
+				n -= count;
+			}
+			return i + offset_scalar(octets + i, size - i, n);
+		}
+
+		// Vectors of ASCII are widened whole. Otherwise the ASCII octets before the first other one are copied, and
+		// the text from there is decoded one code point at a time until two ASCII octets in a row, where a vector is
+		// tried again. CJK or emoji, with at most a space here and there, then costs what decode_scalar does rather
+		// than a vector load for every code point.
+		__attribute__((target("sse2")))
+		std::size_t decode_sse2(const octet_t* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed) noexcept
+		{
+			const __m128i zero = _mm_setzero_si128();
+			std::size_t i = 0;
+			std::size_t written = 0;
+			while (written < max_code_points && i < size)
+			{
+				std::size_t ascii = 0;
+				if (i + 16 <= size && max_code_points - written >= 16)
+				{
+					const __m128i input = load128(octets + i);
+					const std::uint32_t non_ascii = _mm_movemask_epi8(input);
+					if (non_ascii == 0)
+					{
+						const __m128i low = _mm_unpacklo_epi8(input, zero);
+						const __m128i high = _mm_unpackhi_epi8(input, zero);
+						__m128i* const destination = reinterpret_cast<__m128i*>(out + written);
+						_mm_storeu_si128(destination, _mm_unpacklo_epi16(low, zero));
+						_mm_storeu_si128(destination + 1, _mm_unpackhi_epi16(low, zero));
+						_mm_storeu_si128(destination + 2, _mm_unpacklo_epi16(high, zero));
+						_mm_storeu_si128(destination + 3, _mm_unpackhi_epi16(high, zero));
+						i += 16;
+						written += 16;
+						continue;
+					}
+					ascii = __builtin_ctz(non_ascii);
+				}
+
+				for (; ascii > 0; --ascii)
+					out[written++] = octets[i++];
+				while (written < max_code_points && i < size)
+				{
+					if (octets[i] < 0x80)
+					{
+						out[written++] = octets[i++];
+						if (i < size && octets[i] < 0x80)
+							break;
+						continue;
+					}
+					const std::size_t length = decode_one(octets + i, size - i, out[written]);
+					if (length == 0)
+					{
+						octets_consumed = i;
+						return written;
+					}
+					++written;
+					i += length;
+				}
+			}
+			octets_consumed = i;
+			return written;
+		}
+
+		__attribute__((target("avx2")))
+		std::size_t decode_avx2(const octet_t* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed) noexcept
+		{
+			std::size_t i = 0;
+			std::size_t written = 0;
+			while (written < max_code_points && i < size)
+			{
+				std::size_t ascii = 0;
+				if (i + 32 <= size && max_code_points - written >= 32)
+				{
+					const std::uint32_t non_ascii = _mm256_movemask_epi8(load256(octets + i));
+					if (non_ascii == 0)
+					{
+						__m256i* const destination = reinterpret_cast<__m256i*>(out + written);
+						for (int k = 0; k < 4; ++k)
+							_mm256_storeu_si256(destination + k, _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(octets + i + 8*k))));
+						i += 32;
+						written += 32;
+						continue;
+					}
+					ascii = __builtin_ctz(non_ascii);
+				}
+
+				for (; ascii > 0; --ascii)
+					out[written++] = octets[i++];
+				while (written < max_code_points && i < size)
+				{
+					if (octets[i] < 0x80)
+					{
+						out[written++] = octets[i++];
+						if (i < size && octets[i] < 0x80)
+							break;
+						continue;
+					}
+					const std::size_t length = decode_one(octets + i, size - i, out[written]);
+					if (length == 0)
+					{
+						octets_consumed = i;
+						return written;
+					}
+					++written;
+					i += length;
+				}
+			}
+			octets_consumed = i;
+			return written;
+		}
+
+		//
+		// Validation classifies each pair of adjacent octets by three table lookups, on the high and low nibbles
+		// of the first octet and the high nibble of the second, and ANDs the results: any bit left set is an
+		// error. Third and fourth octets of a sequence are checked separately, as must-be-continuation positions.
+		// (After Keiser and Lemire, "Validating UTF-8 in less than one instruction per byte", 2021.)
+		//
+		constexpr octet_t too_short = 1 << 0;	// A lead octet not followed by a continuation.
+		constexpr octet_t too_long = 1 << 1;	// A continuation after an ASCII octet.
+		constexpr octet_t overlong_3 = 1 << 2;
+		constexpr octet_t too_large = 1 << 3;
+		constexpr octet_t surrogate = 1 << 4;
+		constexpr octet_t overlong_2 = 1 << 5;
+		constexpr octet_t too_large_1000 = 1 << 6;
+		constexpr octet_t overlong_4 = 1 << 6;
+		constexpr octet_t two_conts = 1 << 7;	// Two continuations, unless the octet before them requires it.
+		constexpr octet_t carry = too_short | too_long | two_conts;
+
+		alignas(16) constexpr octet_t first_high_nibble[16] = {
+			too_long, too_long, too_long, too_long, too_long, too_long, too_long, too_long,
+			two_conts, two_conts, two_conts, two_conts,
+			too_short | overlong_2,
+			too_short,
+			too_short | overlong_3 | surrogate,
+			too_short | too_large | too_large_1000 | overlong_4
+		};
+
+		alignas(16) constexpr octet_t first_low_nibble[16] = {
+			carry | overlong_3 | overlong_2 | overlong_4,
+			carry | overlong_2,
+			carry,
+			carry,
+			carry | too_large,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000 | surrogate,
+			carry | too_large | too_large_1000,
+			carry | too_large | too_large_1000
+		};
+
+		alignas(16) constexpr octet_t second_high_nibble[16] = {
+			too_short, too_short, too_short, too_short, too_short, too_short, too_short, too_short,
+			too_long | overlong_2 | two_conts | overlong_3 | too_large_1000 | overlong_4,
+			too_long | overlong_2 | two_conts | overlong_3 | too_large,
+			too_long | overlong_2 | two_conts | surrogate | too_large,
+			too_long | overlong_2 | two_conts | surrogate | too_large,
+			too_short, too_short, too_short, too_short
+		};
+
+		// Octets of a final vector that would leave a sequence unfinished: the last three positions may not hold a
+		// lead octet too long to end within the vector.
+		alignas(32) constexpr octet_t incomplete_limit[32] = {
+			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+			0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xf0-1, 0xe0-1, 0xc0-1
+		};
+
+		struct validation_state_sse
+		{
+			__m128i previous;
+			__m128i incomplete;
+			__m128i error;
+		};
+
+		__attribute__((target("sse4.2")))
+		void validate_block_sse42(const __m128i input, validation_state_sse& state)
+		{
+			if (_mm_movemask_epi8(input) == 0)
+				state.error = _mm_or_si128(state.error, state.incomplete);
+			else
+			{
+				const __m128i nibble = _mm_set1_epi8(0x0f);
+				const __m128i prev1 = _mm_alignr_epi8(input, state.previous, 15);
+				const __m128i prev2 = _mm_alignr_epi8(input, state.previous, 14);
+				const __m128i prev3 = _mm_alignr_epi8(input, state.previous, 13);
+
+				const __m128i first_high = _mm_shuffle_epi8(load128(first_high_nibble), _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+				const __m128i first_low = _mm_shuffle_epi8(load128(first_low_nibble), _mm_and_si128(prev1, nibble));
+				const __m128i second_high = _mm_shuffle_epi8(load128(second_high_nibble), _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+				const __m128i special_cases = _mm_and_si128(_mm_and_si128(first_high, first_low), second_high);
+
+				const __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0-0x80)));
+				const __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0-0x80)));
+				const __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+
+				state.error = _mm_or_si128(state.error, _mm_xor_si128(must_continue, special_cases));
+				state.incomplete = _mm_subs_epu8(input, load128(incomplete_limit + 16));
+			}
+			state.previous = input;
+		}
+
+		__attribute__((target("sse4.2")))
+		bool validate_sse42(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			validation_state_sse state{_mm_setzero_si128(), _mm_setzero_si128(), _mm_setzero_si128()};
+			std::size_t i = 0;
+			for (; i + 16 <= size; i += 16)
+				validate_block_sse42(load128(octets + i), state);
+			if (i < size)
+			{
+				octet_t tail[16] = {};
+				std::memcpy(tail, octets + i, size - i);
+				validate_block_sse42(load128(tail), state);
+			}
+			state.error = _mm_or_si128(state.error, state.incomplete);
+			return _mm_testz_si128(state.error, state.error);
+		}
+
+		struct validation_state_avx
+		{
+			__m256i previous;
+			__m256i incomplete;
+			__m256i error;
+		};
+
+		__attribute__((target("avx2")))
+		void validate_block_avx2(const __m256i input, validation_state_avx& state)
+		{
+			if (_mm256_movemask_epi8(input) == 0)
+				state.error = _mm256_or_si256(state.error, state.incomplete);
+			else
+			{
+				const __m256i nibble = _mm256_set1_epi8(0x0f);
+				// The last 16 octets of the previous vector and the first 16 of this one, for alignr to draw on.
+				const __m256i straddle = _mm256_permute2x128_si256(state.previous, input, 0x21);
+				const __m256i prev1 = _mm256_alignr_epi8(input, straddle, 15);
+				const __m256i prev2 = _mm256_alignr_epi8(input, straddle, 14);
+				const __m256i prev3 = _mm256_alignr_epi8(input, straddle, 13);
+
+				const __m256i first_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(load128(first_high_nibble)), _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+				const __m256i first_low = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(load128(first_low_nibble)), _mm256_and_si256(prev1, nibble));
+				const __m256i second_high = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(load128(second_high_nibble)), _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+				const __m256i special_cases = _mm256_and_si256(_mm256_and_si256(first_high, first_low), second_high);
+
+				const __m256i third = _mm256_subs_epu8(prev2, _mm256_set1_epi8(static_cast<char>(0xe0-0x80)));
+				const __m256i fourth = _mm256_subs_epu8(prev3, _mm256_set1_epi8(static_cast<char>(0xf0-0x80)));
+				const __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+
+				state.error = _mm256_or_si256(state.error, _mm256_xor_si256(must_continue, special_cases));
+				state.incomplete = _mm256_subs_epu8(input, load256(incomplete_limit));
+			}
+			state.previous = input;
+		}
+
+		__attribute__((target("avx2")))
+		bool validate_avx2(const octet_t* const octets, const std::size_t size) noexcept
+		{
+			validation_state_avx state{_mm256_setzero_si256(), _mm256_setzero_si256(), _mm256_setzero_si256()};
+			std::size_t i = 0;
+			for (; i + 32 <= size; i += 32)
+				validate_block_avx2(load256(octets + i), state);
+			if (i < size)
+			{
+				octet_t tail[32] = {};
+				std::memcpy(tail, octets + i, size - i);
+				validate_block_avx2(load256(tail), state);
+			}
+			state.error = _mm256_or_si256(state.error, state.incomplete);
+			return _mm256_testz_si256(state.error, state.error);
+		}
+#endif
+
+		const octet_t* as_octets(const char* const octets) noexcept
+		{
+			return reinterpret_cast<const octet_t*>(octets);
+		}
+	} // End of anonymous namespace.
+
+	bool utf8_validate(const char* const octets, const std::size_t size, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return validate_avx2(as_octets(octets), size);
+			case simd_level::sse42:
+				return validate_sse42(as_octets(octets), size);
+#endif
+			default:
+				return validate_scalar(as_octets(octets), size);
+		}
+	}
+
+	bool utf8_is_ascii(const char* const octets, const std::size_t size, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return is_ascii_avx2(as_octets(octets), size);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return is_ascii_sse2(as_octets(octets), size);
+#endif
+			default:
+				return is_ascii_scalar(as_octets(octets), size);
+		}
+	}
+
+	std::size_t utf8_count(const char* const octets, const std::size_t size, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return count_avx2(as_octets(octets), size);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return count_sse2(as_octets(octets), size);
+#endif
+			default:
+				return count_scalar(as_octets(octets), size);
+		}
+	}
+
+	std::size_t utf8_offset(const char* const octets, const std::size_t size, const std::size_t n, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return offset_avx2(as_octets(octets), size, n);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return offset_sse2(as_octets(octets), size, n);
+#endif
+			default:
+				return offset_scalar(as_octets(octets), size, n);
+		}
+	}
+
+	std::size_t utf8_decode(const char* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed, const simd_level level) noexcept
+	{
+		switch (level)
+		{
+#ifdef RHC_TERMWRAP_X86
+			case simd_level::avx2:
+				return decode_avx2(as_octets(octets), size, out, max_code_points, octets_consumed);
+			case simd_level::sse42:
+			case simd_level::sse2:
+				return decode_sse2(as_octets(octets), size, out, max_code_points, octets_consumed);
+#endif
+			default:
+				return decode_scalar(as_octets(octets), size, out, max_code_points, octets_consumed);
+		}
+	}
+
+	bool utf8_validate(const char* const octets, const std::size_t size) noexcept
+	{
+		return utf8_validate(octets, size, active_simd_level());
+	}
+
+	bool utf8_is_ascii(const char* const octets, const std::size_t size) noexcept
+	{
+		return utf8_is_ascii(octets, size, active_simd_level());
+	}
+
+	std::size_t utf8_count(const char* const octets, const std::size_t size) noexcept
+	{
+		return utf8_count(octets, size, active_simd_level());
+	}
+
+	std::size_t utf8_offset(const char* const octets, const std::size_t size, const std::size_t n) noexcept
+	{
+		return utf8_offset(octets, size, n, active_simd_level());
+	}
+
+	std::size_t utf8_decode(const char* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed) noexcept
+	{
+		return utf8_decode(octets, size, out, max_code_points, octets_consumed, active_simd_level());
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,51 @@
+//
+// Termwrap
+//
+// termwrap/utf8_simd.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// Bulk UTF-8 kernels: validation, ASCII detection, code-point counting, locating the octet offset of a code point and
+// decoding to UTF-32. They work a vector at a time (SSE, AVX2) with a scalar fallback, chosen at runtime. The overloads
+// taking a simd_level are for benchmarking and testing against one another.
+//
+// Counting and locating take every octet that is not a continuation octet to start a code point, which agrees with
+// decoding for valid text.
+
+#ifndef RHC_TERMWRAP_UTF8_SIMD_H
+#define RHC_TERMWRAP_UTF8_SIMD_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "simd.hpp"
+
+namespace termwrap
+{
+	// Returns true if the octets are well-formed UTF-8: no overlong forms, surrogates, code points above U+10FFFF
+	// or truncated sequences.
+	bool utf8_validate(const char* const octets, const std::size_t size) noexcept;
+	bool utf8_validate(const char* const octets, const std::size_t size, const simd_level level) noexcept;
+
+	// Returns true if every octet is ASCII, stopping at the first that is not.
+	bool utf8_is_ascii(const char* const octets, const std::size_t size) noexcept;
+	bool utf8_is_ascii(const char* const octets, const std::size_t size, const simd_level level) noexcept;
+
+	// Returns the number of code points in the octets.
+	std::size_t utf8_count(const char* const octets, const std::size_t size) noexcept;
+	std::size_t utf8_count(const char* const octets, const std::size_t size, const simd_level level) noexcept;
+
+	// Returns the octet offset of code point n, or size if there are no more than n code points.
+	std::size_t utf8_offset(const char* const octets, const std::size_t size, const std::size_t n) noexcept;
+	std::size_t utf8_offset(const char* const octets, const std::size_t size, const std::size_t n, const simd_level level) noexcept;
+
+	// Decodes code points into out until max_code_points have been written or the octets run out, and returns the
+	// number written. octets_consumed is set to the number of octets decoded; a sequence truncated by the end of the
+	// octets is left unconsumed. A stray continuation octet decodes to U+FFFD.
+	std::size_t utf8_decode(const char* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed) noexcept;
+	std::size_t utf8_decode(const char* const octets, const std::size_t size, std::uint32_t* const out, const std::size_t max_code_points, std::size_t& octets_consumed, const simd_level level) noexcept;
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMWRAP_UTF8_SIMD_H.
@@ -8,6 +8,19 @@
 //
 
 // utf8_string is designed to be a drop-in replacement for std::basic_string. .capacity() and .max_size() are not included.
+//
+// The string keeps a cached code-point count and a sparse index of the octet offset of every checkpoint_interval-th
+// code point, so length() is O(1) and indexed access need only step over fewer than checkpoint_interval code points
+// from the nearest checkpoint. The index is built lazily as far as it is needed, and an edit drops only the
+// checkpoints that lie after it. Because the index is filled in by const accessors, concurrent reads of one string
+// must be synchronized.
+//
+// A string whose code-point count equals its octet count is all ASCII. It is then indexed by octet arithmetic and
+// never builds checkpoints, and the count kept up to date by every edit keeps that answer current too.
+//
+// basic_utf8_string takes an allocator for its octets and its index, like std::basic_string. utf8_string uses
+// std::allocator; frame_string (frame_arena.hpp) draws from a per-frame arena for scratch text built while drawing.
+// Code points are encoded straight into the storage after it has been grown once to fit them.
 
 #ifndef RHC_TERMWRAP_UTF8_STRING_H
 #define RHC_TERMWRAP_UTF8_STRING_H
@@ -16,8 +29,12 @@
 #include <cstdint>
 #include <iterator>
 #include <initializer_list>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include "utf8_char.hpp"
+#include "utf8_simd.hpp"
 #include "utf8_string_view.hpp"
 #include "/opt/utf8/source/utf8.h"
 
@@ -25,21 +42,33 @@ namespace termwrap
 {
 	using std::uint32_t;
 
-	class utf8_string
+	template <class Alloc = std::allocator<char>>
+	class basic_utf8_string
 	{
 	public:
-		using storage_t = std::string;
+		using storage_t = std::basic_string<char, std::char_traits<char>, Alloc>;
+		using allocator_type = Alloc;
 
 	private:
 		storage_t raw_storage{};
 
 	public:
-		using size_type = storage_t::size_type;
+		using size_type = typename storage_t::size_type;
 		using value_type = std::uint32_t;
-		static constexpr auto npos = storage_t::npos;
+		static constexpr size_type npos = storage_t::npos;
+
+		// One checkpoint (one size_type) per this many code points bounds the index to 1/16 of the octet size.
+		static constexpr size_type checkpoint_interval = 128;
 
-		using iterator = utf8::unchecked::iterator<storage_t::iterator>;
-		using const_iterator = utf8::unchecked::iterator<storage_t::const_iterator>;
+	private:
+		// Code-point count, or npos if it is not yet known.
+		mutable size_type cached_length = npos;
+		// checkpoints[k] is the octet offset of code point k*checkpoint_interval; only a prefix is ever held.
+		mutable std::vector<size_type, typename std::allocator_traits<Alloc>::template rebind_alloc<size_type>> checkpoints{};
+
+	public:
+		using iterator = utf8::unchecked::iterator<typename storage_t::iterator>;
+		using const_iterator = utf8::unchecked::iterator<typename storage_t::const_iterator>;
 		using reverse_iterator = std::reverse_iterator<iterator>;
 		using const_reverse_iterator = std::reverse_iterator<const_iterator>;
 
@@ -48,110 +77,146 @@ namespace termwrap
 		//
 		// Constructors.
 		//
-		utf8_string() noexcept { }
-		utf8_string(size_type count, const uint32_t cp)
+		basic_utf8_string() noexcept : cached_length(0) { }
+		explicit basic_utf8_string(const Alloc& alloc) noexcept
+			: raw_storage(alloc), cached_length(0), checkpoints(alloc)
+		{ }
+		basic_utf8_string(size_type count, const uint32_t cp)
+		{
+			assign(count, cp);
+		}
+		basic_utf8_string(size_type count, const uint32_t cp, const Alloc& alloc)
+			: raw_storage(alloc), checkpoints(alloc)
 		{
 			assign(count, cp);
 		}
-		utf8_string(const utf8_string& other, size_type pos, size_type count = npos)
+		basic_utf8_string(const basic_utf8_string& other, size_type pos, size_type count = npos)
 		{
 			assign(other, pos, count);
 		}
-		utf8_string(const storage_t& other, size_type pos, size_type count = npos)
+		basic_utf8_string(const storage_t& other, size_type pos, size_type count = npos)
 		{
 			raw_storage.assign(storage_t(other, pos, count));
 		}
-		utf8_string(const uint32_t* cps, size_type count)
+		basic_utf8_string(const uint32_t* cps, size_type count)
 		{
-			for (; count > 0; --count)
-				utf8::append(*cps++, std::back_inserter(raw_storage));
+			assign(cps, count);
 		}
-		utf8_string(const uint32_t* cps)
+		basic_utf8_string(const uint32_t* cps)
 		{
-			while (*cps)
-				utf8::append(*cps++, std::back_inserter(raw_storage));
+			assign(cps);
 		}
 		template <class InputIt>
-		utf8_string(InputIt first, InputIt last)
+		basic_utf8_string(InputIt first, InputIt last)
 		{
 			std::copy(first, last, std::back_inserter(raw_storage));
 		}
 		/*template <>
-		utf8_string(utf8::iterator& first, const utf8::iterator& last)
+		basic_utf8_string(utf8::iterator& first, const utf8::iterator& last)
 		{
 			utf8::utf32to8(first, last, std::back_inserter(raw_storage));
 		}*/
-		utf8_string(const utf8_string& other) = default;
-		utf8_string(const storage_t& other) : raw_storage(other) { }
-		utf8_string(utf8_string&& other) = default;
-		utf8_string(const char* const other) : raw_storage(other) { }
-		utf8_string(const std::initializer_list<uint32_t> init)
+		basic_utf8_string(const basic_utf8_string& other) = default;
+		basic_utf8_string(const storage_t& other) : raw_storage(other) { }
+		basic_utf8_string(basic_utf8_string&& other) noexcept
+			: raw_storage(std::move(other.raw_storage)), cached_length(other.cached_length), checkpoints(std::move(other.checkpoints))
 		{
-			utf8::utf32to8(init.begin(), init.end(), std::back_inserter(raw_storage));
+			other.clear();
+		}
+		basic_utf8_string(const char* const other) : raw_storage(other) { }
+		basic_utf8_string(const char* const other, const Alloc& alloc) : raw_storage(other, alloc), checkpoints(alloc) { }
+		basic_utf8_string(const std::initializer_list<uint32_t> init)
+		{
+			assign(init);
+		}
+		explicit basic_utf8_string(utf8_string_view sv) : raw_storage(sv.data(), sv.octet_size())
+		{
+			if (sv.is_ascii())
+				cached_length = raw_storage.size();
+		}
+		basic_utf8_string(utf8_string_view sv, const Alloc& alloc) : raw_storage(sv.data(), sv.octet_size(), alloc), checkpoints(alloc)
+		{
+			if (sv.is_ascii())
+				cached_length = raw_storage.size();
 		}
-		explicit utf8_string(utf8_string_view sv) : raw_storage(sv.data(), sv.size())
-		{ }
 
-		~utf8_string() = default;
-		utf8_string& operator=(const utf8_string& other) = default;
-		utf8_string& operator=(const storage_t& other) { raw_storage.assign(other); return *this; }
-		utf8_string& operator=(const char* str) { raw_storage = str; return *this; }
+		~basic_utf8_string() = default;
+		basic_utf8_string& operator=(const basic_utf8_string& other) = default;
+		basic_utf8_string& operator=(basic_utf8_string&& other) noexcept
+		{
+			raw_storage = std::move(other.raw_storage);
+			cached_length = other.cached_length;
+			checkpoints = std::move(other.checkpoints);
+			other.clear();
+			return *this;
+		}
+		basic_utf8_string& operator=(const storage_t& other) { raw_storage.assign(other); reset_index(); return *this; }
+		basic_utf8_string& operator=(const char* str) { raw_storage = str; reset_index(); return *this; }
+
+		allocator_type get_allocator() const noexcept
+		{
+			return raw_storage.get_allocator();
+		}
 
 		//
 		// Assignment.
 		//
-		utf8_string& assign(size_type count, const uint32_t cp)
+		basic_utf8_string& assign(size_type count, const uint32_t cp)
 		{
 			raw_storage.clear();
-			for (; count > 0; --count)
-				utf8::append(cp, std::back_inserter(raw_storage));
+			reset_index(0);
+			insert_repeated(0, count, cp);
 			return *this;
 		}
-		utf8_string& assign(const utf8_string& str)
+		basic_utf8_string& assign(const basic_utf8_string& str)
 		{
-			raw_storage.assign(str.raw_storage);
+			*this = str;
 			return *this;
 		}
-		utf8_string& assign(const utf8_string& str, size_type pos, size_type count = npos)
+		basic_utf8_string& assign(const basic_utf8_string& str, size_type pos, size_type count = npos)
 		{
-			raw_storage.clear();
-			auto begin = str.cbegin();
-			std::advance(begin, pos);
-
 			count = std::min({count, str.size()-pos});
-			auto end = begin;
-			std::advance(end, count);
+			const auto begin = str.offset_of(pos);
+			const auto end = str.offset_of(pos + count);
 
-			utf32to8(begin, end, std::back_inserter(raw_storage));
+			raw_storage.assign(str.raw_storage, begin, end-begin);
+			reset_index(count);
 			return *this;
 		}
-		utf8_string& assign(utf8_string&& str)
+		basic_utf8_string& assign(basic_utf8_string&& str)
 		{
 			*this = std::move(str);
 			return *this;
 		}
-		utf8_string& assign(const uint32_t* cps)
+		basic_utf8_string& assign(const uint32_t* cps)
+		{
+			return assign(cps, null_terminated_length(cps));
+		}
+		basic_utf8_string& assign(const uint32_t* cps, const size_type count)
 		{
 			raw_storage.clear();
-			while (*cps)
-				utf8::append(*cps++, std::back_inserter(raw_storage));
+			reset_index(0);
+			insert_code_points(0, cps, cps + count);
 			return *this;
 		}
-		utf8_string& assign(const_iterator& first, const const_iterator& last)
+		basic_utf8_string& assign(const_iterator& first, const const_iterator& last)
 		{
 			raw_storage.clear();
 			utf8::utf32to8(first, last, std::back_inserter(raw_storage));
+			reset_index();
 			return *this;
 		}
-		utf8_string& assign(const std::initializer_list<uint32_t> init)
+		basic_utf8_string& assign(const std::initializer_list<uint32_t> init)
 		{
 			raw_storage.clear();
-			utf8::utf32to8(init.begin(), init.end(), std::back_inserter(raw_storage));
+			reset_index(0);
+			insert_code_points(0, init.begin(), init.end());
 			return *this;
 		}
-		utf8_string& assign(const utf8_string_view& sv)
+		basic_utf8_string& assign(const utf8_string_view& sv)
 		{
-			raw_storage.assign(sv.data(), sv.size());
+			raw_storage.assign(sv.data(), sv.octet_size());
+			reset_index(sv.is_ascii() ? raw_storage.size() : npos);
 			return *this;
 		}
 
@@ -161,21 +226,19 @@ namespace termwrap
 		// Note: unlike std::basic_string, these do not return references.
 		uint32_t at(const size_type pos) const
 		{
-			auto it = cbegin();
-			std::advance(it, pos);
-			return *it;
+			if (is_ascii())
+				return static_cast<unsigned char>(raw_storage[pos]);
+			return *const_iterator(raw_storage.cbegin() + offset_of(pos));
 		}
-		utf8_char at(const size_type pos)
+		basic_utf8_char<Alloc> at(const size_type pos)
 		{
-			auto it = begin();
-			std::advance(it, pos);
-			return utf8_char(raw_storage, &*it.base());
+			return basic_utf8_char<Alloc>(*this, pos);
 		}
 		uint32_t operator[](const size_type pos) const
 		{
 			return at(pos);
 		}
-		utf8_char operator[](const size_type pos)
+		basic_utf8_char<Alloc> operator[](const size_type pos)
 		{
 			return at(pos);
 		}
@@ -190,8 +253,10 @@ namespace termwrap
 			--it;
 			return *it;
 		}
+		// The octets may be written through the pointer returned, so the index is discarded.
 		char* data()
 		{
+			reset_index();
 			return raw_storage.data();
 		}
 		const char* data() const
@@ -200,9 +265,7 @@ namespace termwrap
 		}
 		const char* data_at(const size_type pos) const
 		{
-			auto it = raw_storage.cbegin();
-			utf8::unchecked::advance(it, pos);
-			return &*it;
+			return raw_storage.data() + offset_of(pos);
 		}
 		const char* c_str() const
 		{
@@ -210,7 +273,10 @@ namespace termwrap
 		}
 		operator utf8_string_view() const noexcept
 		{
-			return utf8_string_view(raw_storage.data(), raw_storage.length());
+			const utf8_string_view::storage_t octets(raw_storage.data(), raw_storage.length());
+			if (cached_length == npos)
+				return utf8_string_view(octets);
+			return utf8_string_view(octets, is_ascii());
 		}
 		//
 		// Iterators.
@@ -272,12 +338,22 @@ namespace termwrap
 		}
 		size_type size() const noexcept
 		{
-			return utf8::unchecked::distance(raw_storage.cbegin(), raw_storage.cend());
+			if (cached_length == npos)
+				cached_length = count_code_points(raw_storage.data(), raw_storage.size());
+			return cached_length;
 		}
 		size_type length() const noexcept
 		{
 			return size();
 		}
+		size_type octet_size() const noexcept
+		{
+			return raw_storage.size();
+		}
+		bool is_ascii() const noexcept
+		{
+			return size() == raw_storage.size();
+		}
 		void reserve(size_type new_cap = 0)
 		{
 			raw_storage.reserve(new_cap);
@@ -285,6 +361,7 @@ namespace termwrap
 		void shrink_to_fit()
 		{
 			raw_storage.shrink_to_fit();
+			checkpoints.shrink_to_fit();
 		}
 		//
 		// Operations.
@@ -292,87 +369,199 @@ namespace termwrap
 		void clear()
 		{
 			raw_storage.clear();
+			reset_index(0);
 		}
 	private:
-		iterator get_iterator_at(const size_type index)
+		//
+		// Code-point index.
+		//
+		static size_type count_code_points(const char* const octets, const size_type count) noexcept
 		{
-			auto it = begin();
-			std::advance(it, index);
-			return it;
+			return utf8_count(octets, count);
 		}
-		const_iterator get_iterator_at(const size_type index) const
+		// Moves offset on by up to count code points, stopping at the end of the storage, and returns how many were
+		// stepped over.
+		size_type skip_code_points(size_type& offset, const size_type count) const noexcept
 		{
-			auto it = cbegin();
-			std::advance(it, index);
-			return it;
+			const size_type remaining = raw_storage.size() - offset;
+			const size_type step = utf8_offset(raw_storage.data() + offset, remaining, count);
+			offset += step;
+			if (step < remaining)
+				return count;
+			return std::min(count, count_code_points(raw_storage.data() + offset - step, step));
 		}
-		iterator get_end_iterator(const iterator begin, const size_type count = npos)
+		// Returns the octet offset of code point index, or the octet size if index is at or past the end, extending
+		// the checkpoint index as far as index.
+		size_type offset_of(const size_type index) const
 		{
-			if (count == npos)
-				return end();
-			else
+			if (is_ascii())
+				return std::min(index, raw_storage.size());
+			if (index >= cached_length)
+				return raw_storage.size();
+
+			if (checkpoints.empty())
+				checkpoints.push_back(0);
+			const size_type checkpoint = index / checkpoint_interval;
+			while (checkpoints.size() <= checkpoint)
 			{
-				auto end = begin;
-				std::advance(end, count);
-				return end;
+				size_type offset = checkpoints.back();
+				const size_type skipped = skip_code_points(offset, checkpoint_interval);
+				if (skipped < checkpoint_interval)
+				{
+					cached_length = (checkpoints.size()-1)*checkpoint_interval + skipped;
+					return raw_storage.size();
+				}
+				checkpoints.push_back(offset);
 			}
+
+			size_type offset = checkpoints[checkpoint];
+			skip_code_points(offset, index % checkpoint_interval);
+			return offset;
 		}
-		const_iterator get_end_iterator(const const_iterator begin, const size_type count = npos) const
+		// Brings the index up to date after an edit at octet offset that removed and inserted the given numbers of
+		// code points. Checkpoints at or before the offset still hold; later ones are dropped and rebuilt on demand.
+		void update_index(const size_type offset, const size_type removed, const size_type inserted) noexcept
 		{
-			if (count == npos)
-				return cend();
-			else
+			checkpoints.erase(std::upper_bound(checkpoints.begin(), checkpoints.end(), offset), checkpoints.end());
+			if (cached_length != npos)
+				cached_length = cached_length - removed + inserted;
+		}
+		void reset_index(const size_type length = npos) noexcept
+		{
+			checkpoints.clear();
+			cached_length = length;
+		}
+		static size_type encoded_length(const uint32_t cp) noexcept
+		{
+			return (cp < 0x80) ? 1 : (cp < 0x800) ? 2 : (cp < 0x10000) ? 3 : 4;
+		}
+		static size_type null_terminated_length(const uint32_t* const cps) noexcept
+		{
+			size_type length = 0;
+			while (cps[length])
+				++length;
+			return length;
+		}
+		// Encoders size the octets first and then encode in place, so that the storage grows at most once per call.
+		template <class InputIt>
+		size_type insert_code_points(const size_type offset, InputIt first, const InputIt last)
+		{
+			size_type octets = 0;
+			size_type count = 0;
+			for (auto it = first; it != last; ++it, ++count)
+				octets += encoded_length(*it);
+
+			raw_storage.insert(offset, octets, '\0');
+			char* out = &raw_storage[offset];
+			for (; first != last; ++first)
+				out = utf8::append(*first, out);
+			update_index(offset, 0, count);
+			return count;
+		}
+		size_type insert_repeated(const size_type offset, const size_type count, const uint32_t cp)
+		{
+			char encoded[4];
+			const size_type length = utf8::append(cp, encoded) - encoded;
+
+			raw_storage.insert(offset, count * length, '\0');
+			char* out = &raw_storage[offset];
+			for (size_type i = 0; i < count; ++i, out += length)
+				std::copy_n(encoded, length, out);
+			update_index(offset, 0, count);
+			return count;
+		}
+		// Compares the code points in the octets from begin to end with count code points from cps, decoding in
+		// place.
+		int compare_code_points(const size_type begin, const size_type end, const uint32_t* const cps, const size_type count) const noexcept
+		{
+			const char* octet = raw_storage.data() + begin;
+			const char* const last = raw_storage.data() + end;
+			for (size_type i = 0; i < count; ++i)
 			{
-				auto end = begin;
-				std::advance(end, count);
-				return end;
+				if (octet == last)
+					return -1;
+				const uint32_t cp = utf8::unchecked::next(octet);
+				if (cp != cps[i])
+					return (cp < cps[i]) ? -1 : 1;
 			}
+			return (octet == last) ? 0 : 1;
 		}
+		size_type octet_offset(const const_iterator pos) const noexcept
+		{
+			return pos.base() - raw_storage.cbegin();
+		}
+		size_type octet_offset(const iterator pos) const noexcept
+		{
+			return pos.base() - raw_storage.begin();
+		}
+
+		iterator get_iterator_at(const size_type index)
+		{
+			return iterator(raw_storage.begin() + offset_of(index));
+		}
+		const_iterator get_iterator_at(const size_type index) const
+		{
+			return const_iterator(raw_storage.cbegin() + offset_of(index));
+		}
+		// Returns the octet offset of the end of count code points from code point index.
+		size_type end_offset(const size_type index, const size_type count) const
+		{
+			if (count == npos || count >= size() - std::min(index, size()))
+				return raw_storage.size();
+			return offset_of(index + count);
+		}
+		const_iterator get_end_iterator(const size_type index, const size_type count = npos) const
+		{
+			return const_iterator(raw_storage.cbegin() + end_offset(index, count));
+		}
+		friend struct basic_utf8_char<Alloc>;
 	public:
-		utf8_string& insert(const size_type index, size_type count, uint32_t cp)
+		basic_utf8_string& insert(const size_type index, size_type count, uint32_t cp)
 		{
-			auto it = get_iterator_at(index).base();
-			for (; count > 0; --count)
-				utf8::append(cp, std::inserter(raw_storage, it));
+			insert_repeated(offset_of(index), count, cp);
 			return *this;
 		}
-		utf8_string& insert(const size_type index, const uint32_t* cps)
+		basic_utf8_string& insert(const size_type index, const uint32_t* cps)
 		{
-			auto it = get_iterator_at(index);
-			while (*cps)
-				utf8::append(*cps++, std::inserter(raw_storage, it.base()));
-			return *this;
+			return insert(index, cps, null_terminated_length(cps));
 		}
-		utf8_string& insert(const size_type index, const uint32_t* cps, size_type count)
+		basic_utf8_string& insert(const size_type index, const uint32_t* cps, size_type count)
 		{
-			auto it = get_iterator_at(index);
-			for(; count > 0; --count)
-				utf8::append(*cps++, std::inserter(raw_storage, it.base()));
+			insert_code_points(offset_of(index), cps, cps + count);
 			return *this;
 		}
-		utf8_string& insert(const size_type index, const utf8_string& str)
+		basic_utf8_string& insert(const size_type index, const basic_utf8_string& str)
 		{
-			auto it = get_iterator_at(index);
-			raw_storage.insert(it.base(), str.raw_storage.begin(), str.raw_storage.end());
+			const auto offset = offset_of(index);
+			const auto inserted = str.size();
+			raw_storage.insert(offset, str.raw_storage);
+			update_index(offset, 0, inserted);
 			return *this;
 		}
-		utf8_string& insert(const size_type index, const utf8_string& str, const size_type index_str, size_type count = npos)
+		basic_utf8_string& insert(const size_type index, const basic_utf8_string& str, const size_type index_str, size_type count = npos)
 		{
-			auto it = get_iterator_at(index);
-			auto begin = str.get_iterator_at(index_str);
-			auto end = str.get_end_iterator(begin, count);
-			utf32to8(begin, end, std::inserter(raw_storage, it.base()));
+			const auto offset = offset_of(index);
+			const auto begin = str.offset_of(index_str);
+			const auto end = str.end_offset(index_str, count);
+			const auto inserted = count_code_points(str.raw_storage.data() + begin, end - begin);
+			raw_storage.insert(offset, str.raw_storage, begin, end - begin);
+			update_index(offset, 0, inserted);
 			return *this;
 		}
 		iterator insert(iterator pos, uint32_t cp)
 		{
-			utf8::append(cp, std::inserter(raw_storage, pos.base()));
-			return pos;
+			const auto offset = octet_offset(pos);
+			insert_repeated(offset, 1, cp);
+			return iterator(raw_storage.begin() + offset);
 		}
 		template <class InputIt>
 		iterator insert(const_iterator pos, InputIt first, InputIt last)
 		{
-			return raw_storage.insert(pos, first, last);
+			const auto offset = octet_offset(pos);
+			const auto old_size = raw_storage.size();
+			raw_storage.insert(raw_storage.begin() + offset, first, last);
+			update_index(offset, 0, count_code_points(raw_storage.data() + offset, raw_storage.size() - old_size));
+			return iterator(raw_storage.begin() + offset);
 		}
 		/*template <>
 		iterator insert(const_iterator pos, const_iterator first, const const_iterator last)
@@ -382,159 +571,234 @@ namespace termwrap
 		}*/
 		iterator insert(iterator pos, const std::initializer_list<uint32_t> ilist)
 		{
-			utf8::utf32to8(ilist.begin(), ilist.end(), std::inserter(raw_storage, pos.base()));
-			return pos;
+			const auto offset = octet_offset(pos);
+			insert_code_points(offset, ilist.begin(), ilist.end());
+			return iterator(raw_storage.begin() + offset);
 		}
-		//utf8_string& insert(const size_type pos, utf8_string_view& sv)
+		//basic_utf8_string& insert(const size_type pos, utf8_string_view& sv)
 		//template <class T>
-		//utf8_string& insert(const size_type index, const T& t, size_type index_str, size_type count = npos);
-		utf8_string& erase(const size_type index = 0, const size_type count = npos)
-		{
-			auto begin = get_iterator_at(index);
-			auto end = get_end_iterator(begin, count);
-			raw_storage.erase(begin.base(), end.base());
+		//basic_utf8_string& insert(const size_type index, const T& t, size_type index_str, size_type count = npos);
+		basic_utf8_string& erase(const size_type index = 0, const size_type count = npos)
+		{
+			const auto begin = offset_of(index);
+			const auto end = end_offset(index, count);
+			const auto removed = count_code_points(raw_storage.data() + begin, end - begin);
+			raw_storage.erase(begin, end - begin);
+			update_index(begin, removed, 0);
 			return *this;
 		}
 		iterator erase(const_iterator pos) noexcept
 		{
-			auto begin = pos.base();
-			auto base = pos.base();
-			utf8::unchecked::next(base);
-			return iterator(raw_storage.erase(begin, pos.base()));
+			const auto begin = octet_offset(pos);
+			const auto count = utf8_offset(raw_storage.data() + begin, raw_storage.size() - begin, 1);
+			raw_storage.erase(begin, count);
+			update_index(begin, 1, 0);
+			return iterator(raw_storage.begin() + begin);
 		}
 		iterator erase(const_iterator first, const_iterator last) noexcept
 		{
-			return iterator(raw_storage.erase(first.base(), last.base()));
+			const auto begin = octet_offset(first);
+			const auto count = octet_offset(last) - begin;
+			const auto removed = count_code_points(raw_storage.data() + begin, count);
+			raw_storage.erase(begin, count);
+			update_index(begin, removed, 0);
+			return iterator(raw_storage.begin() + begin);
 		}
 		void push_back(uint32_t cp)
 		{
-			utf8::append(cp, std::back_inserter(raw_storage));
+			insert_repeated(raw_storage.size(), 1, cp);
 		}
 		void pop_back()
 		{
 			auto it = raw_storage.cend();
 			utf8::unchecked::prior(it);
+			const auto offset = static_cast<size_type>(it - raw_storage.cbegin());
 			raw_storage.erase(it, raw_storage.cend());
+			update_index(offset, 1, 0);
 		}
-		utf8_string& append(size_type count, uint32_t cp)
+		basic_utf8_string& append(size_type count, uint32_t cp)
 		{
-			for (; count > 0; --count)
-				utf8::append(cp, std::back_inserter(raw_storage));
+			insert_repeated(raw_storage.size(), count, cp);
 			return *this;
 		}
-		utf8_string& append(const uint32_t* cps)
+		basic_utf8_string& append(const uint32_t* cps)
 		{
-			while (*cps)
-				utf8::append(*cps++, std::back_inserter(raw_storage));
-			return *this;
+			return append(cps, null_terminated_length(cps));
 		}
-		utf8_string& append(const uint32_t* cps, size_type count)
+		basic_utf8_string& append(const uint32_t* cps, size_type count)
 		{
-			for(; count > 0; --count)
-				utf8::append(*cps++, std::back_inserter(raw_storage));
+			insert_code_points(raw_storage.size(), cps, cps + count);
 			return *this;
 		}
-		utf8_string& append(const utf8_string& str)
+		basic_utf8_string& append(const basic_utf8_string& str)
 		{
+			const auto offset = raw_storage.size();
+			const auto count = str.size();
 			raw_storage.append(str.raw_storage);
+			update_index(offset, 0, count);
 			return *this;
 		}
-		utf8_string& append(const utf8_string& str, const size_type index_str, size_type count = npos)
+		basic_utf8_string& append(const basic_utf8_string& str, const size_type index_str, size_type count = npos)
 		{
-			auto begin = str.get_iterator_at(index_str);
-			auto end = str.get_end_iterator(begin, count);
-			utf32to8(begin, end, std::back_inserter(raw_storage));
+			const auto offset = raw_storage.size();
+			const auto begin = str.offset_of(index_str);
+			const auto end = str.end_offset(index_str, count);
+			raw_storage.append(str.raw_storage, begin, end - begin);
+			update_index(offset, 0, count_code_points(raw_storage.data() + offset, end - begin));
 			return *this;
 		}
 		template <class InputIt>
-		utf8_string& append(InputIt first, InputIt last)
+		basic_utf8_string& append(InputIt first, InputIt last)
 		{
+			const auto offset = raw_storage.size();
 			raw_storage.append(first, last);
+			update_index(offset, 0, count_code_points(raw_storage.data() + offset, raw_storage.size() - offset));
 			return *this;
 		}
 		/*template <>
-		utf8_string& append(const_iterator first, const const_iterator last)
+		basic_utf8_string& append(const_iterator first, const const_iterator last)
 		{
 			utf8::utf32to8(first, last, std::back_inserter(raw_storage));
 			return *this;
 		}*/
-		utf8_string& append(const std::initializer_list<uint32_t>& ilist)
+		basic_utf8_string& append(const std::initializer_list<uint32_t>& ilist)
 		{
-			utf8::utf32to8(ilist.begin(), ilist.end(), std::back_inserter(raw_storage));
+			insert_code_points(raw_storage.size(), ilist.begin(), ilist.end());
 			return *this;
 		}
-		//utf8_string& append(utf8_string_view& sv)
+		//basic_utf8_string& append(utf8_string_view& sv)
 		//template <class T>
-		//utf8_string& append(const T& t, size_type index_str, size_type count = npos);
-		utf8_string& operator+=(const utf8_string& str)
+		//basic_utf8_string& append(const T& t, size_type index_str, size_type count = npos);
+		basic_utf8_string& operator+=(const basic_utf8_string& str)
 		{
 			return append(str);
 		}
-		utf8_string& operator+=(const uint32_t cp)
+		basic_utf8_string& operator+=(const uint32_t cp)
 		{
 			push_back(cp);
 			return *this;
 		}
-		utf8_string& operator+=(uint32_t* const cps)
+		basic_utf8_string& operator+=(uint32_t* const cps)
 		{
 			return append(cps);
 		}
-		utf8_string& operator+=(const std::initializer_list<uint32_t>& ilist)
+		basic_utf8_string& operator+=(const std::initializer_list<uint32_t>& ilist)
 		{
 			return append(ilist);
 		}
-		//utf8_string& operator+=(const utf8_string_view& sv);
-		int compare(const utf8_string& str) const noexcept
+		//basic_utf8_string& operator+=(const utf8_string_view& sv);
+		int compare(const basic_utf8_string& str) const noexcept
 		{
 			return raw_storage.compare(str.raw_storage);
 		}
-		int compare(const size_type pos1, const size_type count1, const utf8_string& str, const size_type pos2 = 0, const size_type count2 = npos) const
+		int compare(const size_type pos1, const size_type count1, const basic_utf8_string& str, const size_type pos2 = 0, const size_type count2 = npos) const
 		{
-			auto begin = get_iterator_at(pos1);
-			auto end = get_end_iterator(begin, count1);
-			auto str_begin = str.get_iterator_at(pos2);
-			auto str_end = get_end_iterator(str_begin, count2);
-
-			utf8_string temporary(begin, end);
-			utf8_string temporary_str(str_begin, str_end);
+			const auto begin = offset_of(pos1);
+			const auto end = end_offset(pos1, count1);
+			const auto str_begin = str.offset_of(pos2);
+			const auto str_end = str.end_offset(pos2, count2);
 
-			return temporary.compare(temporary_str);
+			return std::string_view(raw_storage.data() + begin, end - begin).compare(std::string_view(str.raw_storage.data() + str_begin, str_end - str_begin));
 		}
 		int compare(const uint32_t* const cps) const
 		{
-			utf8_string temporary(cps);
-			return compare(temporary);
+			return compare_code_points(0, raw_storage.size(), cps, null_terminated_length(cps));
 		}
 		int compare(const size_type pos1, const size_type count1, const uint32_t* const cps) const
 		{
-			utf8_string temporary(cps);
-			return compare(pos1, count1, temporary);
+			return compare_code_points(offset_of(pos1), end_offset(pos1, count1), cps, null_terminated_length(cps));
 		}
 		int compare(const size_type pos1, const size_type count1, const uint32_t* const cps, const size_type count2) const
 		{
-			utf8_string temporary(cps, count2);
-			return compare(pos1, count1, temporary);
+			return compare_code_points(offset_of(pos1), end_offset(pos1, count1), cps, count2);
+		}
+		int compare(const utf8_string_view& sv) const noexcept
+		{
+			return utf8_string_view(*this).compare(sv);
+		}
+		int compare(const char* const octets) const noexcept
+		{
+			return compare(utf8_string_view(octets));
+		}
+		//
+		// Searching, by way of utf8_string_view.
+		//
+		size_type find(const utf8_string_view& sv, const size_type pos = 0) const noexcept
+		{
+			return utf8_string_view(*this).find(sv, pos);
+		}
+		size_type find(const uint32_t cp, const size_type pos = 0) const noexcept
+		{
+			return utf8_string_view(*this).find(cp, pos);
+		}
+		size_type rfind(const utf8_string_view& sv, const size_type pos = npos) const noexcept
+		{
+			return utf8_string_view(*this).rfind(sv, pos);
+		}
+		size_type rfind(const uint32_t cp, const size_type pos = npos) const noexcept
+		{
+			return utf8_string_view(*this).rfind(cp, pos);
+		}
+		size_type find_first_of(const utf8_string_view& sv, const size_type pos = 0) const noexcept
+		{
+			return utf8_string_view(*this).find_first_of(sv, pos);
+		}
+		size_type find_last_of(const utf8_string_view& sv, const size_type pos = npos) const noexcept
+		{
+			return utf8_string_view(*this).find_last_of(sv, pos);
+		}
+		bool starts_with(const utf8_string_view& sv) const noexcept
+		{
+			return utf8_string_view(*this).starts_with(sv);
+		}
+		bool ends_with(const utf8_string_view& sv) const noexcept
+		{
+			return utf8_string_view(*this).ends_with(sv);
 		}
-		// int compare ... string_view
 		// replace
 		//
-		template <class CharT, class Traits>
-		friend std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const utf8_string& str);
+	}; // End of class basic_utf8_string.
 
-	}; // End of class utf8_string.
+	using utf8_string = basic_utf8_string<>;
 
-	template <class CharT, class Traits>
-	std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const utf8_string& str)
+	template <class CharT, class Traits, class Alloc>
+	std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const basic_utf8_string<Alloc>& str)
 	{
 		std::ostream::sentry s(os);
 		if (s)
 		{
-			os.write(str.raw_storage.data(), str.raw_storage.length());
+			os.write(str.data(), str.octet_size());
 		}
 		return os;
 	}
 
+	//
+	// basic_utf8_char, which needs the complete basic_utf8_string.
+	//
+	template <class Alloc>
+	basic_utf8_char<Alloc>::operator uint32_t() const
+	{
+		return static_cast<const basic_utf8_string<Alloc>&>(owner).at(position);
+	}
+
+	template <class Alloc>
+	basic_utf8_char<Alloc>& basic_utf8_char<Alloc>::operator=(const uint32_t cp)
+	{
+		const auto begin = owner.offset_of(position);
+		const auto end = owner.end_offset(position, 1);
+		char encoded[4];
+		const auto encoded_end = utf8::append(cp, encoded);
+		owner.raw_storage.replace(begin, end - begin, encoded, encoded_end - encoded);
+		owner.update_index(begin, 1, 1);
+		return *this;
+	}
+
+	template <class Alloc>
+	const char* basic_utf8_char<Alloc>::operator&() const
+	{
+		return static_cast<const basic_utf8_string<Alloc>&>(owner).data_at(position);
+	}
+
 } // End of namespace termwrap.
 
 #endif // !RHC_TERMWRAP_UTF8_STRING_H
-
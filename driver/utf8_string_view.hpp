@@ -8,15 +8,26 @@
 //
 
 // utf8_string_view is designed to be a drop-in replacement for std::basic_string_view.
+//
+// A view notes whether its octets are all ASCII the first time it needs to know, and then measures and indexes by
+// octet arithmetic alone. Views taken from an ASCII view, or from a utf8_string that knows its length, inherit the
+// answer without a scan.
+//
+// Searches and comparisons work on the octets and never decode or copy: UTF-8 octet order is code point order, and
+// a match of well-formed UTF-8 always starts on a code point. Positions in and out are still code point positions.
 
 #ifndef RHC_TERMWRAP_UTF8_STRING_VIEW_H
 #define RHC_TERMWRAP_UTF8_STRING_VIEW_H
 
+#include <algorithm>
 #include <cstdint>
 #include <cstring>
 #include <iterator>
 #include <string_view>
+#include <utility>
 #include "/opt/utf8/source/utf8.h"
+#include "utf8_search.hpp"
+#include "utf8_simd.hpp"
 
 namespace termwrap
 {
@@ -36,7 +47,19 @@ namespace termwrap
 		const static auto npos = storage_t::npos;
 
 	private:
+		enum class ascii_state : unsigned char
+		{
+			unknown,
+			ascii,
+			mixed
+		};
+
 		storage_t octet_view;
+		mutable ascii_state ascii = ascii_state::unknown;
+
+		constexpr utf8_string_view(const storage_t& sv, const ascii_state state) noexcept
+			: octet_view{sv}, ascii(state)
+		{ }
 
 	public:
 		//
@@ -58,6 +81,10 @@ namespace termwrap
 		constexpr utf8_string_view(const char* const s)
 			: octet_view{s}
 		{ }
+		// For callers that already know whether sv is all ASCII.
+		constexpr utf8_string_view(const storage_t& sv, const bool is_ascii) noexcept
+			: octet_view{sv}, ascii(is_ascii ? ascii_state::ascii : ascii_state::mixed)
+		{ }
 
 		constexpr utf8_string_view& operator=(const utf8_string_view& sv) noexcept = default;
 
@@ -102,9 +129,9 @@ namespace termwrap
 		//
 		/*constexpr*/ value_type operator[](const size_type pos) const
 		{
-			auto it = cbegin();
-			std::advance(it, pos);
-			return *it;
+			if (is_ascii())
+				return static_cast<unsigned char>(octet_view[pos]);
+			return *const_iterator(octet_view.cbegin() + octet_count(pos));
 		}
 		/*constexpr*/ value_type at(const size_type pos) const
 		{
@@ -128,9 +155,7 @@ namespace termwrap
 		}
 		const_pointer data_at(const size_type pos) const
 		{
-			auto it = octet_view.cbegin();
-			utf8::unchecked::advance(it, pos);
-			return &*it;
+			return octet_view.data() + octet_count(pos);
 		}
 
 		//
@@ -138,7 +163,9 @@ namespace termwrap
 		//
 		size_type size() const noexcept
 		{
-			return utf8::unchecked::distance(octet_view.cbegin(), octet_view.cend());
+			if (is_ascii())
+				return octet_view.size();
+			return utf8_count(octet_view.data(), octet_view.size());
 		}
 		size_type length() const noexcept
 		{
@@ -152,20 +179,30 @@ namespace termwrap
 		{
 			return octet_view.empty();
 		}
+		bool is_ascii() const noexcept
+		{
+			if (ascii == ascii_state::unknown)
+				ascii = utf8_is_ascii(octet_view.data(), octet_view.size()) ? ascii_state::ascii : ascii_state::mixed;
+			return ascii == ascii_state::ascii;
+		}
 		//
 		// Modifiers.
 		//
 		/*constexpr*/ void remove_prefix(size_type n)
 		{
 			octet_view.remove_prefix(octet_count(n));
+			ascii = inherited_ascii_state();
 		}
 		/*constexpr*/ void remove_suffix(size_type n)
 		{
-			octet_view.remove_suffix(octet_count(n, octet_view.crbegin()));
+			const auto length = size();
+			octet_view.remove_suffix(octet_view.size() - ((n < length) ? octet_count(length - n) : 0));
+			ascii = inherited_ascii_state();
 		}
 		void swap(utf8_string_view& other) noexcept
 		{
 			octet_view.swap(other.octet_view);
+			std::swap(ascii, other.ascii);
 		}
 		//
 		// Operations.
@@ -173,21 +210,113 @@ namespace termwrap
 		size_type copy(char* dest, const size_type count, const size_type pos = 0) const
 		{
 			const auto octet_pos = octet_count(pos);
-			auto octet_it = &octet_view[octet_pos];
-			const auto octet_c   = octet_count(count, octet_it);
+			const auto octet_c = octet_count(count, octet_pos);
 			octet_view.copy(dest, octet_c, octet_pos);
 			return octet_c;
 		}
 		/*constexpr*/ utf8_string_view substr(const size_type pos = 0, const size_type count = npos) const
 		{
 			const auto octet_pos = octet_count(pos);
-			const auto rcount = std::min((octet_view.length() - octet_pos), octet_count(count));
-			return utf8_string_view(&octet_view[octet_pos], rcount);
+			const auto rcount = octet_count(count, octet_pos);
+			return utf8_string_view(octet_view.substr(octet_pos, rcount), inherited_ascii_state());
+		}
+		// A view of count octets from octet pos, which must both fall on code point boundaries.
+		utf8_string_view octet_substr(const size_type pos, const size_type count = npos) const
+		{
+			return utf8_string_view(octet_view.substr(pos, count), inherited_ascii_state());
+		}
+		//
+		// Searching.
+		//
+		size_type find(const utf8_string_view& v, const size_type pos = 0) const noexcept
+		{
+			const auto start = octet_count(pos);
+			if (start == octet_view.size() && pos > size())
+				return npos;
+			if (v.empty())
+				return pos;
+			const auto rest = octet_view.size() - start;
+			const auto at = utf8_find(octet_view.data() + start, rest, v.data(), v.octet_size());
+			return (at == rest) ? npos : pos + code_points_in(start, at);
+		}
+		size_type find(const value_type cp, const size_type pos = 0) const noexcept
+		{
+			char encoded[4];
+			return find(encode(cp, encoded), pos);
+		}
+		size_type rfind(const utf8_string_view& v, const size_type pos = npos) const noexcept
+		{
+			const auto limit = octet_count(pos);
+			if (v.empty())
+				return (limit == octet_view.size()) ? std::min(pos, size()) : pos;
+			const auto searched = std::min(octet_view.size(), limit + v.octet_size());
+			const auto at = utf8_find_last(octet_view.data(), searched, v.data(), v.octet_size());
+			return (at == searched) ? npos : code_points_in(0, at);
+		}
+		size_type rfind(const value_type cp, const size_type pos = npos) const noexcept
+		{
+			char encoded[4];
+			return rfind(encode(cp, encoded), pos);
+		}
+		size_type find_first_of(const utf8_string_view& v, const size_type pos = 0) const noexcept
+		{
+			const auto start = octet_count(pos);
+			if (v.empty())
+				return npos;
+			const auto rest = octet_view.size() - start;
+			const auto at = utf8_find_first_of(octet_view.data() + start, rest, v.data(), v.octet_size());
+			return (at == rest) ? npos : pos + code_points_in(start, at);
+		}
+		size_type find_first_of(const value_type cp, const size_type pos = 0) const noexcept
+		{
+			return find(cp, pos);
+		}
+		size_type find_last_of(const utf8_string_view& v, const size_type pos = npos) const noexcept
+		{
+			if (v.empty())
+				return npos;
+			// Up to and including the code point at pos.
+			const auto searched = (pos == npos) ? octet_view.size() : octet_count(pos + 1);
+			const auto at = utf8_find_last_of(octet_view.data(), searched, v.data(), v.octet_size());
+			return (at == searched) ? npos : code_points_in(0, at);
+		}
+		size_type find_last_of(const value_type cp, const size_type pos = npos) const noexcept
+		{
+			return rfind(cp, pos);
+		}
+		bool starts_with(const utf8_string_view& v) const noexcept
+		{
+			return octet_view.substr(0, v.octet_size()) == v.octet_view;
+		}
+		bool starts_with(const value_type cp) const noexcept
+		{
+			char encoded[4];
+			return starts_with(encode(cp, encoded));
+		}
+		bool ends_with(const utf8_string_view& v) const noexcept
+		{
+			return octet_view.size() >= v.octet_size() && octet_view.substr(octet_view.size() - v.octet_size()) == v.octet_view;
+		}
+		bool ends_with(const value_type cp) const noexcept
+		{
+			char encoded[4];
+			return ends_with(encode(cp, encoded));
 		}
-		// find, rfind, find_first_of, find_last_of, et c..
 		//
 		// Comparisons.
 		//
+		int compare(const utf8_string_view& v) const noexcept
+		{
+			return octet_view.compare(v.octet_view);
+		}
+		int compare(const size_type pos1, const size_type count1, const utf8_string_view& v) const noexcept
+		{
+			return substr(pos1, count1).compare(v);
+		}
+		int compare(const size_type pos1, const size_type count1, const utf8_string_view& v, const size_type pos2, const size_type count2) const noexcept
+		{
+			return substr(pos1, count1).compare(v.substr(pos2, count2));
+		}
 		/*constexpr*/ bool operator==(const utf8_string_view& other) const noexcept
 		{
 			return (octet_view == other.octet_view);
@@ -217,23 +346,31 @@ namespace termwrap
 		//
 		// Helpers.
 		//
-		/*constexpr*/ size_type octet_count(const size_type cp_count) const
+		// Octets in the first cp_count code points from octet offset start, or all of them if there are fewer.
+		/*constexpr*/ size_type octet_count(const size_type cp_count, const size_type start = 0) const noexcept
 		{
-			return octet_count(cp_count, octet_view.cbegin());
+			const size_type available = octet_view.size() - start;
+			if (is_ascii())
+				return std::min(cp_count, available);
+			return utf8_offset(octet_view.data() + start, available, cp_count);
 		}
-
-		template <class Iterator>
-		size_type octet_count(size_type cp_count, Iterator begin) const
-		{
-			if (cp_count == npos) return npos;
-			size_type octets = 0;
-			for (; cp_count > 0; --cp_count)
-			{
-				const auto octets_per_cp = utf8::internal::sequence_length(begin);
-				octets += octets_per_cp;
-				std::advance(begin, octets_per_cp);
-			}
-			return octets;
+		// Code points in the count octets from octet offset start.
+		size_type code_points_in(const size_type start, const size_type count) const noexcept
+		{
+			if (is_ascii())
+				return count;
+			return utf8_count(octet_view.data() + start, count);
+		}
+		// A view of cp encoded into out, which must have room for four octets.
+		static utf8_string_view encode(const value_type cp, char* const out) noexcept
+		{
+			const char* const end = utf8::unchecked::append(cp, out);
+			return utf8_string_view(storage_t(out, end - out), cp < 0x80 ? ascii_state::ascii : ascii_state::mixed);
+		}
+		// Part of an ASCII view is ASCII; part of any other view may or may not be.
+		ascii_state inherited_ascii_state() const noexcept
+		{
+			return (ascii == ascii_state::ascii) ? ascii_state::ascii : ascii_state::unknown;
 		}
 
 	}; // End of class utf8_string_view.
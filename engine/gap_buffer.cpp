@@ -0,0 +1,168 @@
+//
+// Termwrap
+//
+// termwrap/gap_buffer.cpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+#include "gap_buffer.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <string_view>
+
+#include "/opt/utf8/source/utf8.h"
+#include "../driver/utf8_simd.hpp"
+
+namespace termwrap
+{
+	namespace
+	{
+		// The smallest buffer allocated, so that short fields grow their gap only a few times.
+		constexpr std::size_t min_capacity = 64;
+
+		bool is_continuation(const char octet) noexcept
+		{
+			return (static_cast<unsigned char>(octet) & 0xc0) == 0x80;
+		}
+	} // End of anonymous namespace.
+
+	gap_buffer::gap_buffer(const string_view& text)
+	{
+		assign(text);
+	}
+
+	void gap_buffer::assign(const string_view& text)
+	{
+		buffer.assign(text.data(), text.data() + text.octet_size());
+		gap_begin = gap_end = buffer.size();
+		gap_position = code_points = text.length();
+	}
+
+	void gap_buffer::clear() noexcept
+	{
+		buffer.clear();
+		gap_begin = gap_end = 0;
+		gap_position = code_points = 0;
+	}
+
+	void gap_buffer::insert(const size_type pos, const u8char_t cp)
+	{
+		char encoded[4];
+		const char* const encoded_end = utf8::unchecked::append(cp, encoded);
+		move_gap(pos);
+		reserve_gap(encoded_end - encoded);
+		fill_gap(encoded, encoded_end - encoded, 1);
+	}
+
+	void gap_buffer::insert(const size_type pos, const string_view& text)
+	{
+		if (text.empty())
+			return;
+		move_gap(pos);
+		reserve_gap(text.octet_size());
+		fill_gap(text.data(), text.octet_size(), text.length());
+	}
+
+	void gap_buffer::erase(const size_type pos, const size_type count)
+	{
+		if (pos >= code_points)
+			return;
+		move_gap(pos);
+		gap_end += utf8_offset(buffer.data() + gap_end, buffer.size() - gap_end, count);
+		code_points -= std::min(count, code_points - gap_position);
+	}
+
+	void gap_buffer::replace(const size_type pos, const u8char_t cp)
+	{
+		erase(pos, 1);
+		insert(pos, cp);
+	}
+
+	std::pair<string_view, string_view> gap_buffer::window(const size_type pos, const size_type count) const
+	{
+		if (pos >= code_points || count == 0)
+			return {};
+
+		const size_type begin = text_offset(pos);
+		const size_type end = (count >= code_points - pos) ? octet_size() : text_offset(pos + count);
+		std::pair<string_view, string_view> parts;
+		if (begin < gap_begin)
+			parts.first = std::string_view(buffer.data() + begin, std::min(end, gap_begin) - begin);
+		if (end > gap_begin)
+		{
+			const size_type first = std::max(begin, gap_begin);
+			parts.second = std::string_view(buffer.data() + buffer_index(first), end - first);
+		}
+		return parts;
+	}
+
+	string_view gap_buffer::view() noexcept
+	{
+		move_gap(code_points);
+		return std::string_view(buffer.data(), gap_begin);
+	}
+
+	// Steps from the start of the text or from an edge of the gap, whichever is nearest.
+	gap_buffer::size_type gap_buffer::text_offset(const size_type pos) const noexcept
+	{
+		if (pos >= code_points)
+			return octet_size();
+		if (pos >= gap_position)
+			return gap_begin + utf8_offset(buffer.data() + gap_end, buffer.size() - gap_end, pos - gap_position);
+		if (pos <= gap_position - pos)
+			return utf8_offset(buffer.data(), gap_begin, pos);
+
+		size_type offset = gap_begin;
+		for (size_type k = gap_position - pos; k > 0; --k)
+		{
+			do
+				--offset;
+			while (offset > 0 && is_continuation(buffer[offset]));
+		}
+		return offset;
+	}
+
+	void gap_buffer::move_gap(const size_type pos) noexcept
+	{
+		const size_type offset = text_offset(pos);
+		if (offset < gap_begin)
+		{
+			const size_type moved = gap_begin - offset;
+			std::memmove(buffer.data() + gap_end - moved, buffer.data() + offset, moved);
+			gap_begin -= moved;
+			gap_end -= moved;
+		}
+		else if (offset > gap_begin)
+		{
+			const size_type moved = offset - gap_begin;
+			std::memmove(buffer.data() + gap_begin, buffer.data() + gap_end, moved);
+			gap_begin += moved;
+			gap_end += moved;
+		}
+		gap_position = std::min(pos, code_points);
+	}
+
+	// Grows the buffer geometrically, moving the text after the gap to the new end.
+	void gap_buffer::reserve_gap(const size_type octets)
+	{
+		if (gap_end - gap_begin >= octets)
+			return;
+
+		const size_type tail = buffer.size() - gap_end;
+		const size_type new_size = std::max({buffer.size() * 2, octet_size() + octets, min_capacity});
+		buffer.resize(new_size);
+		std::memmove(buffer.data() + new_size - tail, buffer.data() + gap_end, tail);
+		gap_end = new_size - tail;
+	}
+
+	void gap_buffer::fill_gap(const char* const octets, const size_type size, const size_type count) noexcept
+	{
+		std::memcpy(buffer.data() + gap_begin, octets, size);
+		gap_begin += size;
+		gap_position += count;
+		code_points += count;
+	}
+} // End of namespace termwrap.
@@ -0,0 +1,82 @@
+//
+// Termwrap
+//
+// termwrap/gap_buffer.hpp
+//
+// Copyright Dr Robert H Crowston, 2017. All rights reserved.
+// See LICENCE for licensing rights.
+//
+
+// gap_buffer holds editable UTF-8 text with a gap of free octets at the last edit. An edit next to the gap is a copy
+// into or out of it; an edit elsewhere first moves the gap there, which costs a move of the octets in between. So
+// typing, deleting and overwriting at a cursor are O(1) however long the text is.
+//
+// Positions are code points. The number of code points before the gap is kept, so a position is found by stepping
+// from whichever of the start of the text or either edge of the gap is nearest; positions around the cursor, which
+// is where editing and drawing happen, are found in time proportional to their distance from it.
+//
+// window() reads part of the text in place as the two runs either side of the gap. view() closes the gap up against
+// the end of the text, which is free if it is already there, so that the whole text can be read as one view.
+
+#ifndef RHC_TERMBOX_GAP_BUFFER_H
+#define RHC_TERMBOX_GAP_BUFFER_H
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "../driver/types.hpp"
+
+namespace termwrap
+{
+	class gap_buffer
+	{
+	public:
+		using size_type = std::size_t;
+
+	private:
+		std::vector<char> buffer{};
+		// The gap is buffer[gap_begin, gap_end).
+		size_type gap_begin = 0;
+		size_type gap_end = 0;
+		// Code points before the gap, and in all.
+		size_type gap_position = 0;
+		size_type code_points = 0;
+
+	public:
+		gap_buffer() = default;
+		explicit gap_buffer(const string_view& text);
+
+		void assign(const string_view& text);
+		void clear() noexcept;
+
+		size_type length() const noexcept { return code_points; }
+		size_type octet_size() const noexcept { return buffer.size() - (gap_end - gap_begin); }
+		bool empty() const noexcept { return code_points == 0; }
+
+		// Positions past the end are taken to be the end.
+		void insert(size_type pos, const u8char_t cp);
+		void insert(size_type pos, const string_view& text);
+		void erase(size_type pos, const size_type count = 1);
+		void replace(const size_type pos, const u8char_t cp);
+
+		// Up to count code points from pos, as the parts before and after the gap. Either part may be empty.
+		std::pair<string_view, string_view> window(const size_type pos, const size_type count) const;
+
+		// The whole text as one view, which is invalidated by the next edit.
+		string_view view() noexcept;
+
+	private:
+		// The offset of code point pos in the text, not counting the gap.
+		size_type text_offset(const size_type pos) const noexcept;
+		size_type buffer_index(const size_type offset) const noexcept
+		{
+			return (offset < gap_begin) ? offset : offset + (gap_end - gap_begin);
+		}
+		void move_gap(const size_type pos) noexcept;
+		void reserve_gap(const size_type octets);
+		void fill_gap(const char* const octets, const size_type size, const size_type count) noexcept;
+	}; // End of class gap_buffer.
+} // End of namespace termwrap.
+
+#endif // !RHC_TERMBOX_GAP_BUFFER_H
@@ -10,17 +10,34 @@
 #include "textbox.hpp"
 
 #include <algorithm>
+#include <string_view>
 
 #include "driver.hpp"
+#include "../driver/utf8_simd.hpp"
 
 namespace termwrap
 {
+	namespace
+	{
+		bool is_continuation(const char octet) noexcept
+		{
+			return (static_cast<unsigned char>(octet) & 0xc0) == 0x80;
+		}
+	} // End of anonymous namespace.
+
 	textbox::textbox(driver& parent, const ordinate_t begin_x, const ordinate_t begin_y, const ordinate_t display_width, const size_t max_content_length, const cell_style& unfilled_style, const cell_style& filled_style)
 		: parent(parent), max_content_length(max_content_length), display_width(display_width), begin_x(begin_x), begin_y(begin_y), unfilled_style(unfilled_style), filled_style(filled_style)
 	{
 		redraw();
 	}
 
+	void textbox::set_content(const string_view& text)
+	{
+		content.assign(text);
+		content_changed = true;
+		redraw();
+	}
+
 	void textbox::redraw()
 	{
 		cursor_position = std::min( {content.length(), max_content_length-1, cursor_position} );
@@ -39,12 +56,10 @@ namespace termwrap
 
 		const size_t effective_view_position = (has_focus) ? view_position : 0;
 		const size_t cursor_view_position = cursor_position-view_position;
-		const auto content_view = string_view(content.data_at(effective_view_position), std::min<size_t>(content.length()-effective_view_position, display_width));
+		const size_t shown_length = std::min<size_t>(content.length()-std::min(effective_view_position, content.length()), display_width);
 
-		parent.write_at(begin_x, begin_y, content_view, filled_style);
-		
-		if (display_width - content_view.length() > 0)
-			parent.write_at(begin_x+content_view.length(), begin_y, string(display_width-content_view.length(), ' '), unfilled_style);
+		if (!shown_valid || content_changed || effective_view_position != shown_view_position)
+			draw_field(effective_view_position, shown_length);
 
 		if (has_focus)
 			parent.set_cursor_position(begin_x+cursor_view_position, begin_y);
@@ -52,6 +67,57 @@ namespace termwrap
 		parent.redraw();
 	}
 
+	// Copies out the visible text, read in place in two parts if it straddles the gap, and compares it with what was
+	// last drawn. The text before the first octet that differs and, if the text still fills as many cells, after the
+	// last one is already on screen; only the cells in between are written.
+	void textbox::draw_field(const size_t first, const size_t count)
+	{
+		const auto visible = content.window(first, count);
+		next_text.assign(visible.first.data(), visible.first.data()+visible.first.octet_size());
+		next_text.insert(next_text.end(), visible.second.data(), visible.second.data()+visible.second.octet_size());
+
+		size_t prefix = 0;
+		size_t suffix = 0;
+		size_t changed_begin = 0;
+		size_t changed_end = display_width;
+		if (shown_valid)
+		{
+			prefix = std::mismatch(next_text.begin(), next_text.end(), shown_text.begin(), shown_text.end()).first - next_text.begin();
+			while (prefix > 0 && prefix < next_text.size() && is_continuation(next_text[prefix]))
+				--prefix;
+			changed_begin = utf8_count(next_text.data(), prefix);
+
+			if (count == shown_filled)
+			{
+				const size_t limit = std::min(next_text.size(), shown_text.size()) - prefix;
+				suffix = std::mismatch(next_text.rbegin(), next_text.rbegin()+limit, shown_text.rbegin()).first - next_text.rbegin();
+				while (suffix > 0 && is_continuation(next_text[next_text.size()-suffix]))
+					--suffix;
+				changed_end = count - utf8_count(next_text.data()+next_text.size()-suffix, suffix);
+			}
+			else
+				changed_end = std::max(count, shown_filled);
+		}
+
+		if (prefix < next_text.size()-suffix)
+		{
+			const std::string_view changed(next_text.data()+prefix, next_text.size()-suffix-prefix);
+			parent.write_at(begin_x+changed_begin, begin_y, changed, filled_style);
+		}
+		if (std::max(count, changed_begin) < changed_end)
+		{
+			const size_t padding_begin = std::max(count, changed_begin);
+			const frame_string padding(changed_end-padding_begin, ' ', parent.get_frame_arena().allocator<char>());
+			parent.write_at(begin_x+padding_begin, begin_y, padding, unfilled_style);
+		}
+
+		shown_text.swap(next_text);
+		shown_filled = count;
+		shown_view_position = first;
+		shown_valid = true;
+		content_changed = false;
+	}
+
 	void textbox::cursor_left()
 	{
 		cursor_position -= (cursor_position > 0) ? 1 : 0;
@@ -93,7 +159,7 @@ namespace termwrap
 	{
 		set_focus();
 		
-		if (event.ctrl)
+		if (event.ctrl || event.alt)
 			return;
 	
 		if (const auto key = std::get_if<special_key>(&event.key))
@@ -122,6 +188,7 @@ namespace termwrap
 					if (content.length() > 0 && cursor_position <= content.length())
 					{
 						content.erase(cursor_position, 1);
+						content_changed = true;
 						redraw();
 					}
 					break;
@@ -129,6 +196,7 @@ namespace termwrap
 					if (content.length() > 0 && cursor_position > 0)
 					{
 						content.erase(cursor_position-1, 1);
+						content_changed = true;
 						--cursor_position;
 						redraw();
 					}
@@ -148,18 +216,57 @@ namespace termwrap
 
 		if (const auto ch = std::get_if<u8char_t>(&event.key))
 		{
-			if (cursor_position == content.length())
-				content.push_back(*ch);
-			else if (mode == insert_mode::overwrite)
-				content[cursor_position] = *ch;
-			else // mode == insert_mode::insert
-				content.insert(cursor_position, 1, *ch);
+			if (mode == insert_mode::overwrite && cursor_position < content.length())
+				content.replace(cursor_position, *ch);
+			else
+				content.insert(cursor_position, *ch);
+			content_changed = true;
 			++cursor_position;
 		}
 
 		redraw();
 	}
 	
+	void textbox::accept_event(const event& event)
+	{
+		if (const auto key = std::get_if<key_event>(&event))
+			accept_key_event(*key);
+		else if (const auto paste = std::get_if<paste_event>(&event))
+			insert_text(paste->text);
+	}
+
+	void textbox::insert_text(const string_view& text)
+	{
+		set_focus();
+
+		cursor_position = std::min(cursor_position, content.length());
+		if (cursor_position >= max_content_length)
+			return;
+		size_t room = (mode == insert_mode::insert) ? max_content_length - std::min(content.length(), max_content_length) : max_content_length - cursor_position;
+
+		// Control characters are single octets, and never occur within a multi-octet sequence, so the text is
+		// inserted a printable run at a time straight from the octets.
+		const char* octet = text.data();
+		const char* const last = octet + text.octet_size();
+		while (octet != last && room > 0)
+		{
+			const char* const run_end = std::find_if(octet, last, [](const char c) { return static_cast<unsigned char>(c) < 0x20 || c == 0x7f; });
+			const string_view run = text.octet_substr(octet - text.data(), run_end - octet).substr(0, room);
+			const size_t run_length = run.length();
+
+			if (mode == insert_mode::overwrite)
+				content.erase(cursor_position, run_length);
+			content.insert(cursor_position, run);
+			content_changed = true;
+			cursor_position += run_length;
+			room -= run_length;
+
+			octet = (run_end == last) ? last : run_end + 1;
+		}
+
+		redraw();
+	}
+
 	textbox::~textbox()
 	{
 		set_focus(false);
@@ -10,10 +10,14 @@
 #ifndef RHC_TERMBOX_TEXTBOX_H
 #define RHC_TERMBOX_TEXTBOX_H
 
+#include <vector>
+
 #include "../driver/cell_style.hpp"
 #include "../driver/driver.hpp"
+#include "../driver/event.hpp"
 #include "../driver/key_event.hpp"
 #include "../driver/types.hpp"
+#include "gap_buffer.hpp"
 
 namespace termwrap
 {
@@ -31,7 +35,7 @@ namespace termwrap
 		cell_style unfilled_style{};
 		cell_style filled_style{};
 
-		string content{};
+		gap_buffer content{};
 
 	public:
 		enum class insert_mode
@@ -49,6 +53,18 @@ namespace termwrap
 		size_t view_position = 0;
 		size_t cursor_position = 0;
 
+		// What was last drawn: the visible text, the number of cells it filled, and the view position it was taken
+		// from. redraw() writes only the cells that differ from these, and if neither the text nor the view has
+		// changed it only moves the cursor.
+		std::vector<char> shown_text{};
+		std::vector<char> next_text{};
+		size_t shown_filled = 0;
+		size_t shown_view_position = 0;
+		bool shown_valid = false;
+		bool content_changed = true;
+
+		void draw_field(const size_t first, const size_t count);
+
 	public:
 		textbox(driver& parent, const ordinate_t start_x, const ordinate_t start_y, const ordinate_t display_width, const size_t max_content_length, const cell_style& unfilled_style, const cell_style& filled_style);
 		textbox(const textbox& ) = delete;
@@ -58,7 +74,7 @@ namespace termwrap
 		~textbox();
 
 		void set_content(const string_view& content);
-		string_view get_content() noexcept { return content; }
+		string_view get_content() noexcept { return content.view(); }
 
 		bool check_input_accepted() noexcept { return input_accepted; } 
 
@@ -74,7 +90,10 @@ namespace termwrap
 		void set_cursor_position(const size_t position) noexcept { cursor_position = position; }
 		size_t get_cursor_position() noexcept { return cursor_position; }
 
+		// Draws whatever has changed since the last redraw. Call invalidate() first if something else may have
+		// drawn over the field, such as a driver::clear(), so that the whole field is drawn again.
 		void redraw();
+		void invalidate() noexcept { shown_valid = false; }
 		
 		void cursor_left();
 		void cursor_right();
@@ -82,6 +101,11 @@ namespace termwrap
 		void cursor_end();
 
 		void accept_key_event(const key_event& event);
+		void accept_event(const event& event);
+
+		// Inserts (or overwrites with) as much of text as fits, as if it were typed, but moves the cursor and
+		// redraws only once. Line breaks and other control characters are left out.
+		void insert_text(const string_view& text);
 	
 	}; // End of class textbox.
 } // End of namespace termwrap.